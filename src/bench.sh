@@ -0,0 +1,110 @@
+#!/bin/bash
+# usage: bench.sh [out.json]
+#
+# loopback benchmark of jana's own hot paths. every measurement is
+# repeated $REPS times and written as json with mean/stddev/min/max so
+# two builds can be compared. tune with the environment variables below.
+
+JANA=${JANA:-./jana}
+OUT=${1:-bench.json}
+REPS=${REPS:-3}
+TIME=${TIME:-2}
+PORT=${PORT:-3900}
+SIZES=${SIZES:-"64 512 1472 8972"}
+GAPS=${GAPS:-"1000 100 20"}
+
+TMP=$(mktemp -d /tmp/jana-bench.XXXXXX)
+trap 'pkill -P $$ > /dev/null 2>&1; rm -rf $TMP' EXIT
+
+# name params unit value...
+RESULTS=()
+record() {
+	local name=$1 params=$2 unit=$3
+	shift 3
+	RESULTS+=("$(echo "$@" | awk -v name="$name" -v params="$params" -v unit="$unit" '{
+		n = NF; sum = 0; min = $1; max = $1; runs = ""
+		for (i = 1; i <= n; i++) {
+			sum += $i
+			if ($i < min) min = $i
+			if ($i > max) max = $i
+			runs = runs (i > 1 ? "," : "") $i
+		}
+		mean = sum / n; var = 0
+		for (i = 1; i <= n; i++) var += ($i - mean) ^ 2
+		sd = n > 1 ? sqrt(var / (n - 1)) : 0
+		printf "{\"name\":\"%s\",\"params\":{%s},\"unit\":\"%s\",\"runs\":[%s],", name, params, unit, runs
+		printf "\"mean\":%.3f,\"stddev\":%.3f,\"min\":%.3f,\"max\":%.3f}", mean, sd, min, max
+	}')")
+	echo "$name {$params} $* $unit" >&2
+}
+
+# one loopback test: server log to $TMP/server.out, client log to $TMP/log.csv
+pair() {
+	$JANA -s 1 -p $PORT -t $TIME --sync 0 > $TMP/server.out 2> /dev/null &
+	local spid=$!
+	sleep 0.2
+	$JANA -c 127.0.0.1 -p $PORT -t $TIME --sync 0 -f $TMP/log.csv "$@" > /dev/null 2> $TMP/client.err
+	# wait for the server summary, it is flushed once the late packets are gone
+	for i in $(seq 50); do
+		grep -q "late packets" $TMP/server.out && break
+		sleep 0.1
+	done
+	kill $spid > /dev/null 2>&1
+	wait $spid 2> /dev/null
+}
+
+sent() {
+	tr '\r' '\n' < $TMP/client.err | sed -n 's/.*(\([0-9]\+\) packets sent).*/\1/p'
+}
+
+received() {
+	sed -n 's/.* \([0-9]\+\) pkts .*/\1/p' $TMP/server.out | head -1
+}
+
+# client/server max pps per payload size (no pacing)
+for size in $SIZES; do
+	tx=(); rx=()
+	for r in $(seq $REPS); do
+		pair -d uniform n=0,k=$((size - 4))
+		tx+=($(echo "$(sent) $TIME" | awk '{ printf "%.1f", $1 / $2 }'))
+		rx+=($(echo "$(received) $TIME" | awk '{ printf "%.1f", $1 / $2 }'))
+	done
+	record client_pps "\"size\":$size" pps "${tx[@]}"
+	record server_pps "\"size\":$size" pps "${rx[@]}"
+done
+
+# pacing accuracy: mean absolute deviation of send gaps from the set gap
+for gap in $GAPS; do
+	err=()
+	for r in $(seq $REPS); do
+		pair -r uniform n=0,k=$gap
+		err+=($(awk -F, -v gap=$gap 'NR > 2 { d = ($2 - prev) - gap; s += d < 0 ? -d : d; n++ }
+			NR > 1 { prev = $2 } END { printf "%.3f", n ? s / n : 0 }' $TMP/log.csv))
+	done
+	record pacing_error "\"gap_us\":$gap" us "${err[@]}"
+done
+
+# random variates and log writing, in process
+declare -A micro micro_unit
+for r in $(seq $REPS); do
+	while read -r _ _ name value unit; do
+		micro[$name]="${micro[$name]} $value"
+		micro_unit[$name]=$unit
+	done < <($JANA --microbench)
+done
+for name in "${!micro[@]}"; do
+	record $name "" ${micro_unit[$name]} ${micro[$name]}
+done
+
+{
+	printf '{"host":"%s","kernel":"%s","reps":%d,"time":%d,"results":[' \
+		"$(hostname)" "$(uname -r)" $REPS $TIME
+	sep=""
+	for r in "${RESULTS[@]}"; do
+		printf '%s\n%s' "$sep" "$r"
+		sep=","
+	done
+	printf '\n]}\n'
+} > $OUT
+
+echo "wrote $OUT" >&2
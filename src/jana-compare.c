@@ -0,0 +1,326 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#define MAX_METRICS  (512)
+#define MAX_LINE     (1 << 16)
+#define BOOTSTRAP    (10000)
+
+/**
+ * all values of one `role/key` metric, split by the two labels
+ */
+struct series
+{
+	char    name[96];
+	double *v[2];
+	size_t  n[2];
+	size_t  cap[2];
+};
+
+static struct series metrics[MAX_METRICS];
+static size_t n_metrics;
+
+void usage() {
+    fprintf(stderr, "Usage: jana-compare store label-a label-b [metric ...]\n");
+    fprintf(stderr, "       jana-compare [-h|--help]\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "  store          result store written by jana --store\n");
+    fprintf(stderr, "  label-a        baseline runs (jana --label)\n");
+    fprintf(stderr, "  label-b        runs compared against the baseline\n");
+    fprintf(stderr, "  metric         only these metrics, as role/key (default: all)\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Per metric the median of each group, the change of the median\n");
+    fprintf(stderr, "with a 95%% bootstrap confidence interval, and the two-sided\n");
+    fprintf(stderr, "p-value of a Mann-Whitney U test. '*' marks p < 0.05.\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Examples:\n");
+    fprintf(stderr, "  jana-compare results.txt fw-1.2 fw-1.3\n");
+    fprintf(stderr, "  jana-compare results.txt fw-1.2 fw-1.3 server/rx_mbps server/loss_pct\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Built " __DATE__ " " __TIME__ "\n");
+    exit(1);
+}
+
+struct series *series_get(const char *name)
+{
+	for (size_t i = 0; i < n_metrics; ++i)
+		if (strcmp(metrics[i].name, name) == 0)
+			return metrics + i;
+
+	if (n_metrics == MAX_METRICS)
+		return NULL;
+
+	struct series *s = metrics + n_metrics++;
+	snprintf(s->name, sizeof s->name, "%s", name);
+	return s;
+}
+
+void series_add(struct series *s, int g, double v)
+{
+	if (s->n[g] == s->cap[g]) {
+		s->cap[g] = s->cap[g] ? 2 * s->cap[g] : 16;
+		s->v[g] = realloc(s->v[g], s->cap[g] * sizeof(double));
+		if (s->v[g] == NULL) {
+			perror("series_add");
+			exit(1);
+		}
+	}
+	s->v[g][s->n[g]++] = v;
+}
+
+/**
+ * one store record: the label picks the group, metrics are the keys
+ * without a dot whose value is a number
+ */
+void parse_record(char *line, const char *labels[2])
+{
+	char *label = NULL, *role = "?";
+	char *tok, *save;
+	int g;
+
+	for (tok = strtok_r(line, " \t\n", &save); tok; tok = strtok_r(NULL, " \t\n", &save)) {
+		if (strncmp(tok, "label=", 6) == 0)
+			label = tok + 6;
+		else if (strncmp(tok, "role=", 5) == 0)
+			role = tok + 5;
+		if (label && role[0] != '?')
+			break;
+	}
+
+	if (label == NULL)
+		return;
+	if (strcmp(label, labels[0]) == 0)
+		g = 0;
+	else if (strcmp(label, labels[1]) == 0)
+		g = 1;
+	else
+		return;
+
+	for (tok = strtok_r(NULL, " \t\n", &save); tok; tok = strtok_r(NULL, " \t\n", &save)) {
+		char *eq = strchr(tok, '='), *end;
+		char name[96];
+
+		if (eq == NULL || memchr(tok, '.', eq - tok) != NULL)
+			continue;
+
+		*eq = '\0';
+		double v = strtod(eq + 1, &end);
+		if (end == eq + 1 || *end != '\0')
+			continue;
+
+		snprintf(name, sizeof name, "%s/%s", role, tok);
+		struct series *s = series_get(name);
+		if (s != NULL)
+			series_add(s, g, v);
+	}
+}
+
+int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double*)a, y = *(const double*)b;
+	return x < y ? -1 : x > y;
+}
+
+double median(double *v, size_t n)
+{
+	qsort(v, n, sizeof(double), cmp_double);
+	return n % 2 ? v[n/2] : (v[n/2 - 1] + v[n/2]) / 2;
+}
+
+static uint64_t rng = 0x9e3779b97f4a7c15ull;
+
+static inline uint32_t rng_below(uint32_t n)
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 7;
+	rng ^= rng << 17;
+	return (uint32_t)((rng >> 32) * n >> 32);
+}
+
+/**
+ * percentile bootstrap of median(b) - median(a), fixed seed so the same
+ * store always gives the same interval
+ */
+void bootstrap(struct series *s, double *lo, double *hi)
+{
+	double *diff = malloc(BOOTSTRAP * sizeof(double));
+	double *r[2];
+
+	r[0] = malloc(s->n[0] * sizeof(double));
+	r[1] = malloc(s->n[1] * sizeof(double));
+	if (diff == NULL || r[0] == NULL || r[1] == NULL) {
+		perror("bootstrap");
+		exit(1);
+	}
+
+	for (int k = 0; k < BOOTSTRAP; ++k) {
+		for (int g = 0; g < 2; ++g)
+			for (size_t i = 0; i < s->n[g]; ++i)
+				r[g][i] = s->v[g][rng_below(s->n[g])];
+		diff[k] = median(r[1], s->n[1]) - median(r[0], s->n[0]);
+	}
+
+	qsort(diff, BOOTSTRAP, sizeof(double), cmp_double);
+	*lo = diff[(int)(0.025 * BOOTSTRAP)];
+	*hi = diff[(int)(0.975 * BOOTSTRAP) - 1];
+
+	free(r[1]);
+	free(r[0]);
+	free(diff);
+}
+
+/**
+ * two-sided Mann-Whitney U test. small samples without ties use the
+ * exact distribution of U, everything else the normal approximation
+ * with tie and continuity correction.
+ */
+double mann_whitney(struct series *s)
+{
+	size_t n1 = s->n[0], n2 = s->n[1], n = n1 + n2;
+	double *all = malloc(n * sizeof(double));
+	double rank_a = 0, ties = 0;
+	bool tied = false;
+
+	if (all == NULL) {
+		perror("mann_whitney");
+		exit(1);
+	}
+
+	memcpy(all, s->v[0], n1 * sizeof(double));
+	memcpy(all + n1, s->v[1], n2 * sizeof(double));
+	qsort(all, n, sizeof(double), cmp_double);
+
+	// rank sum of group a, ties get their mean rank
+	for (size_t i = 0; i < n; ) {
+		size_t j = i;
+		while (j < n && all[j] == all[i])
+			j++;
+		double rank = (i + 1 + j) / 2.0, t = j - i;
+		if (t > 1) {
+			tied = true;
+			ties += t * t * t - t;
+		}
+		for (size_t k = 0; k < n1; ++k)
+			if (s->v[0][k] == all[i])
+				rank_a += rank;
+		i = j;
+	}
+	free(all);
+
+	double u = rank_a - n1 * (n1 + 1) / 2.0;
+
+	if (!tied && n1 <= 20 && n2 <= 20) {
+		// f[i][j][u]: orderings of i a's and j b's with statistic u
+		size_t umax = n1 * n2, w = umax + 1;
+		double *f = calloc((n1 + 1) * (n2 + 1) * w, sizeof(double));
+		if (f == NULL) {
+			perror("mann_whitney");
+			exit(1);
+		}
+#define F(i, j, k) f[((i) * (n2 + 1) + (j)) * w + (k)]
+		for (size_t i = 0; i <= n1; ++i)
+			for (size_t j = 0; j <= n2; ++j)
+				for (size_t k = 0; k <= i * j; ++k) {
+					if (i == 0 || j == 0) {
+						F(i, j, k) = k == 0;
+						continue;
+					}
+					F(i, j, k) = (k >= j ? F(i-1, j, k-j) : 0) + F(i, j-1, k);
+				}
+
+		double total = 0, below = 0, above = 0;
+		for (size_t k = 0; k <= umax; ++k) {
+			total += F(n1, n2, k);
+			if (k <= u)
+				below += F(n1, n2, k);
+			if (k >= u)
+				above += F(n1, n2, k);
+		}
+#undef F
+		free(f);
+
+		double p = 2 * (below < above ? below : above) / total;
+		return p > 1 ? 1 : p;
+	}
+
+	double mu = n1 * n2 / 2.0;
+	double var = n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1.0)));
+	if (var <= 0)
+		return 1;
+
+	double z = (fabs(u - mu) - 0.5) / sqrt(var);
+	return z > 0 ? erfc(z / sqrt(2)) : 1;
+}
+
+bool wanted(const char *name, int argc, char const *argv[])
+{
+	if (argc <= 4)
+		return true;
+	for (int i = 4; i < argc; ++i)
+		if (strcmp(argv[i], name) == 0)
+			return true;
+	return false;
+}
+
+void print_change(double d, double base)
+{
+	if (base != 0)
+		printf(" %+9.2f%%", 100 * d / base);
+	else
+		printf(" %+10.3g", d);
+}
+
+int main(int argc, char const *argv[])
+{
+	if (argc < 4 ||
+		strcmp("-h", argv[1]) == 0 ||
+		strcmp("--help", argv[1]) == 0) usage();
+
+	const char *labels[2] = { argv[2], argv[3] };
+	static char line[MAX_LINE];
+
+	FILE *fp = fopen(argv[1], "r");
+	if (fp == NULL) {
+		perror("error reading file");
+		exit(1);
+	}
+
+	while (fgets(line, sizeof line, fp) != NULL)
+		parse_record(line, labels);
+	fclose(fp);
+
+	printf("%-26s %4s %12s %4s %12s %10s %23s %8s\n",
+		"metric", "n", labels[0], "n", labels[1], "change", "95% ci", "p");
+
+	for (size_t i = 0; i < n_metrics; ++i) {
+		struct series *s = metrics + i;
+
+		if (!wanted(s->name, argc, argv) || s->n[0] == 0 || s->n[1] == 0)
+			continue;
+
+		double a = median(s->v[0], s->n[0]);
+		double b = median(s->v[1], s->n[1]);
+
+		printf("%-26s %4zu %12.3f %4zu %12.3f", s->name, s->n[0], a, s->n[1], b);
+		print_change(b - a, a);
+
+		if (s->n[0] < 2 || s->n[1] < 2) {
+			printf(" %23s %8s\n", "-", "-");
+			continue;
+		}
+
+		double lo, hi, p = mann_whitney(s);
+		bootstrap(s, &lo, &hi);
+
+		printf("  [");
+		print_change(lo, a);
+		printf(",");
+		print_change(hi, a);
+		printf("] %8.4f%s\n", p, p < 0.05 ? " *" : "");
+	}
+
+	return 0;
+}
@@ -1,93 +1,73 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
-#include <inttypes.h>
 #include <stdbool.h>
-#include <assert.h>
-#include <math.h>
-
-#define MAX_PACKETS (5000000)
-#define MAX_CLIENTS (256)
-
-#include <linux/net_tstamp.h>
-#include <sys/socket.h>
-#include <sys/types.h>
-#include <arpa/inet.h>
-#include <netinet/in.h>
-#include <fcntl.h>
-#include <unistd.h>
 #include <time.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <arpa/inet.h>
 
-#define MAX_PKT_SIZE (64100)
-
-
-float rand1() { return ((float)rand())/((float)(RAND_MAX)+1); }
-
-typedef union pdf_cfg_s
-{
-	struct uniform
-	{
-		float n;
-		float k;
-	} uniform;
-
-	struct exp
-	{
-		float n;
-	} exp;
-
-	struct weibull
-	{
-		float a;
-		float b;
-	} weibull;
-} pdf_cfg_t;
-
-typedef float (*pdf_rv_fn)(pdf_cfg_t*);
-
-float uniform_rvs(pdf_cfg_t *cfg)
-{
-	return cfg->uniform.n * rand1() + cfg->uniform.k;
-}
+#if defined(__has_include)
+#if __has_include(<linux/if_xdp.h>)
+#define JANA_XDP
+#endif
+#endif
 
-float exp_rvs(pdf_cfg_t *cfg)
-{
-	float x = rand1();
-	return -cfg->exp.n * log(1.0 - x);
-}
-// x = −(1/β)*ln(α∏i=1(Ui))
-float weibull_rvs(pdf_cfg_t *cfg)
-{
-	float x = rand1();
-	float i = cfg->weibull.a - 1.0;
-	while (i-- >= 1) {
-		x *= rand1();
-	}
-	return -(1.0/cfg->weibull.b) * log(x);
-}
+#include "jana.h"
 
 void usage() {
-    fprintf(stderr, "Usage: jana [-s clients|-c host|-x host] [options]\n");
+    fprintf(stderr, "Usage: jana [-s clients|-c host|-x host|--clocktest|--microbench] [options]\n");
     fprintf(stderr, "       jana [-h|--help]\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "  -s X           run in server mode with X clients\n");
     fprintf(stderr, "  -c host        run as client, connect to host (ip addr)\n");
     fprintf(stderr, "  -x host        run as dummy client, connecting to host and exiting on test start\n");
+    fprintf(stderr, "  --clocktest    report resolution and cost of the timestamp source\n");
+    fprintf(stderr, "  --microbench   measure random variate and log write throughput\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "Server or Client:\n");
     fprintf(stderr, "  -p, --port     port to listen on/connect to\n");
-    fprintf(stderr, "  -f, --file     name of statistics/data logfile\n");
+    fprintf(stderr, "  -f, --file     name of statistics/data logfile (none with --sweep)\n");
     fprintf(stderr, "  -t, --time X   test duration in X seconds\n");
+    fprintf(stderr, "      --tcp      send/receive paced, framed messages over tcp instead of udp\n");
+    fprintf(stderr, "      --verify S pattern payloads with a crc32c trailer, seed S (both ends)\n");
+    fprintf(stderr, "      --store F  append a result record of each test to F (see jana-compare)\n");
+    fprintf(stderr, "      --label L  label of the records in --store (default \"default\")\n");
+    fprintf(stderr, "      --raw IF   client: send prebuilt frames through a PACKET_TX_RING on IF\n");
+    fprintf(stderr, "      --xdp IF   client: send prebuilt frames through AF_XDP (copy mode) on IF\n");
+    fprintf(stderr, "      --dst-mac M   next hop mac for --raw/--xdp (default: arp table)\n");
+    fprintf(stderr, "      --batch N  frames per kernel kick for --raw/--xdp (default 64)\n");
+    fprintf(stderr, "      --rt C[,P] pin to cpu C (-1 any), SCHED_FIFO prio P, mlockall\n");
+    fprintf(stderr, "      --overhead report syscall cost, pacing error and send/recv errors\n");
+    fprintf(stderr, "      --perf     count cycles, instructions and cache misses of the test\n");
     fprintf(stderr, "Client specific:\n");
     fprintf(stderr, "  -r, --rate [D] packet transmission rate distribution [us]\n");
     fprintf(stderr, "  -d, --data [D] packet data size distribution [bytes]\n");
     fprintf(stderr, "  -l, --loop     loop test until quit by Ctrl-C\n");
+    fprintf(stderr, "      --scenario F  run the flow classes in scenario file F instead of -r/-d\n");
+    fprintf(stderr, "      --sockets N   socket pool size for --scenario (default 8)\n");
+    fprintf(stderr, "      --replay F    send with the timing and sizes of schedule F (pcap2csv -w)\n");
+    fprintf(stderr, "      --speed X     replay X times faster than captured\n");
+    fprintf(stderr, "      --pps N       replay time-scaled to an average of N packets/s\n");
+    fprintf(stderr, "      --sync N   clock probes before/after each test, 0 disables (default 16)\n");
+    fprintf(stderr, "      --receivers N servers to wait for when host is a multicast group (default 1)\n");
+    fprintf(stderr, "      --ttl N       multicast ttl (default 1)\n");
+    fprintf(stderr, "      --mcast-if A  send multicast through the interface with address A\n");
+    fprintf(stderr, "      --sweep S R   one test per payload size in S and rate in R [pps, 0 = max]\n");
+    fprintf(stderr, "      --warmup MS   unmeasured traffic before each sweep cell (default 200)\n");
+    fprintf(stderr, "      --sweep-json F   also write the sweep table to F\n");
     fprintf(stderr, "Server specific:\n");
+    fprintf(stderr, "      --burst-bin U  microburst bin width in us (default 10)\n");
+    fprintf(stderr, "      --join G[,A]   receive multicast group G on the interface with address A\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "Examples:\n");
     fprintf(stderr, "  jana -s 1 -p 3333\n");
     fprintf(stderr, "  jana -c 192.168.1.5 -p 3333\n");
+    fprintf(stderr, "  jana -s 1 --join 239.1.1.1,127.0.0.1   (several times)\n");
+    fprintf(stderr, "  jana -c 239.1.1.1 --mcast-if 127.0.0.1 --receivers 4 -r uniform n=0,k=100\n");
+    fprintf(stderr, "  jana -c 192.168.1.5 -t 2 --sweep 64,512,1472,1473,8000 1000,10000,0\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "[D] indicates options that support a notation for");
     fprintf(stderr, " expressing distribution functions:\n");
@@ -105,421 +85,6 @@ void usage() {
     exit(1);
 }
 
-/**
- * hash a client's ip
- */
-uint32_t chash(struct sockaddr_in *sa)
-{
-	uint32_t addr = sa->sin_addr.s_addr;
-	return addr >> 24;
-
-}
-
-enum jana_mode { jana_decide, jana_client, jana_server, jana_dummy };
-
-struct config
-{
-	enum     jana_mode 		mode;
-	struct   sockaddr_in 	addr;
-
-	pdf_rv_fn				wait_rv;
-	pdf_rv_fn				data_rv;
-
-	pdf_cfg_t 				wait_pdf;
-	pdf_cfg_t 				data_pdf;
-
-	uint32_t n_clients;
-	bool 	 keepalive;
-	int 	 testtime;
-
-	const char *logfile;
-};
-
-uint64_t clock_elapsed_us(clockid_t clk, struct timespec *c)
-{
-	struct timespec now;
-	clock_gettime(clk, &now);
-	if (c != NULL) {
-		now.tv_sec -= c->tv_sec;
-		now.tv_nsec -= c->tv_nsec;
-	}
-	return (uint64_t)(now.tv_sec) * 1000000 + (now.tv_nsec) / 1000;
-}
-
-double clock_elapsed_sec(struct timespec *c)
-{
-	struct timespec now;
-	clock_gettime(CLOCK_MONOTONIC, &now);
-	if (c != NULL)
-		now.tv_sec -= c->tv_sec;
-	return (double)(now.tv_sec);
-}
-
-
-/**
- * poor man's socket wrapper
- */
-int init_socket(struct sockaddr_in *addr, bool nonblock)
-{
-	int sockfd;
-
-	sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-
-	if (sockfd <= 0) {
-		perror("init_socket: failed to create socket");
-		exit(1);
-	}
-
-	if (bind(sockfd, (const struct sockaddr*)addr, sizeof(struct sockaddr_in)) < 0) {
-		perror("init_socket: failed to bind socket");
-		close(sockfd);
-		exit(1);
-	}
-
-	if (nonblock) {
-		fcntl(sockfd, F_SETFL, O_NONBLOCK);
-	}
-
-	return sockfd;
-}
-
-bool read_message(int sockfd, const char *want, struct sockaddr_in *from)
-{
-	static char storage[100];
-	struct sockaddr addr;
-	socklen_t fromlen = sizeof addr;
-
-	int len = recvfrom(sockfd, storage, 100, 0, &addr, &fromlen);
-
-	if (len <= 0) {
-		return false;
-	}
-
-	if (from != 0)
-		*from = *((struct sockaddr_in*)&addr);
-
-	storage[len] = '\0';
-	return strcmp(storage, want) == 0;
-}
-
-bool cmpaddr(struct sockaddr_in *a, struct sockaddr_in *b)
-{
-	return a->sin_addr.s_addr == b->sin_addr.s_addr;
-}
-
-const char * SPINNER[] = { "/", "-", "\\", "|" };
-
-void run_client(struct config *cfg)
-{
-	static uint8_t zero_bytes[MAX_PKT_SIZE] = {0};
-
-	struct sockaddr_in local_addr;
-	local_addr.sin_family = AF_INET;
-	local_addr.sin_addr.s_addr = INADDR_ANY;
-	local_addr.sin_port = 0;
-
-	char str[INET_ADDRSTRLEN];
-	inet_ntop(AF_INET, &(cfg->addr.sin_addr), str, INET_ADDRSTRLEN);
-	printf("> using %s:%d\n", str, ntohs(cfg->addr.sin_port));
-
-	int heartfd = init_socket(&local_addr, true);
-	int sockfd = init_socket(&local_addr, false);
-
-	uint32_t packet_id;
-	uint64_t *packet_ttime;
-	uint64_t *packet_delay;
-	uint32_t *wait_rvs;
-	uint32_t *data_rvs;
-
-	packet_delay = calloc(MAX_PACKETS, sizeof(uint64_t));
-	packet_ttime = calloc(MAX_PACKETS, sizeof(uint64_t));
-
-	wait_rvs = calloc(MAX_PACKETS, sizeof(uint32_t));
-	if (!wait_rvs) {
-		perror("run_client: error allocating delay array");
-		exit(1);
-	}
-
-	data_rvs = calloc(MAX_PACKETS, sizeof(uint32_t));
-	if (!data_rvs) {
-		perror("run_client: allocating data array");
-		exit(1);
-	}
-
-	if (cfg->wait_rv) {
-		fprintf(stderr, "> generating delay distribution...");
-		for (size_t i = 0; i < MAX_PACKETS; ++i)
-			wait_rvs[i] = cfg->wait_rv(&cfg->wait_pdf);
-		fprintf(stderr, "OK\n");
-	}
-
-	if (cfg->data_rv != NULL) {
-		fprintf(stderr, "> generating data distribution...");
-		for (size_t i = 0; i < MAX_PACKETS; ++i)
-			data_rvs[i] = cfg->data_rv(&cfg->data_pdf);
-		fprintf(stderr, "OK\n");
-	}
-
-init_phase:
-	{
-		uint32_t i = 0;
-		do {
-			fprintf(stderr, "\r> registering ");
-			fprintf(stderr, "%s", SPINNER[i % 4]);
-
-			if (i++ % 50 == 0) {
-				static const char *MSG = "HELLO";
-				sendto(heartfd, MSG, strlen(MSG)+1, 0, (struct sockaddr*)&cfg->addr, sizeof(struct sockaddr_in));
-			}
-
-			usleep(120*1000);
-		} while (!read_message(heartfd, "HELLO", 0));
-		fprintf(stderr, "\r> registering OK\n");
-	}
-
-	{
-		uint32_t i = 0;
-		do {
-			if (i > 300) {
-				fprintf(stderr, "\r> timeout after 36 s\n");
-				goto init_phase;
-			}
-
-			fprintf(stderr, "\r> waiting to start ");
-			fprintf(stderr, "%s", SPINNER[i++ % 4]);
-
-			usleep(120*1000);
-		} while (!read_message(heartfd, "READY", 0));
-		fprintf(stderr, "\r> got the ready signal\n");
-	}
-
-	usleep(500*1000);
-
-	if (cfg->mode == jana_dummy) {
-		fprintf(stderr, "> in dummy mode, exiting\n");
-		goto cleanup;
-	}
-
-	{
-		static const char *MSG = "SETGO";
-		sendto(sockfd, MSG, strlen(MSG)+1, 0,
-					(struct sockaddr*)(&cfg->addr),
-					sizeof(struct sockaddr_in));
-	}
-
-	usleep(500*1000);
-
-	{
-		struct timespec tp_start;
-		struct timespec tp_now;
-		uint32_t data_len;
-
-		packet_id = 0;
-
-		clock_gettime(CLOCK_MONOTONIC, &tp_start);
-		fprintf(stderr, "\r> running test ...");
-		do {
-			uint32_t *data = (uint32_t*)zero_bytes;
-			*data = htonl(packet_id);
-			data_len = sizeof(uint32_t) + data_rvs[packet_id];
-
-			if (cfg->wait_rv)
-				usleep(wait_rvs[packet_id]);
-
-			uint64_t t = clock_elapsed_us(CLOCK_REALTIME, NULL);
-			clock_gettime(CLOCK_MONOTONIC, &tp_now);
-
-			sendto(sockfd,
-				zero_bytes,
-				data_len,
-				0, (struct sockaddr*)(&cfg->addr), sizeof(struct sockaddr_in));
-
-			uint64_t us = clock_elapsed_us(CLOCK_MONOTONIC, &tp_now);
-
-			assert (packet_id < MAX_PACKETS);
-			packet_ttime[packet_id] = t;
-			packet_delay[packet_id] = us;
-			++packet_id;
-		} while (clock_elapsed_sec(&tp_start) < cfg->testtime);
-		fprintf(stderr, "\r> network test is done (%u packets sent)\n", packet_id);
-	}
-
-	{
-		fprintf(stderr, "> %s ...", cfg->logfile);
-		FILE *logfd = fopen(cfg->logfile, "w");
-		fprintf(logfd, "packet,time,sendto_us\n");
-		for (uint64_t i = 0; i < packet_id; i++) {
-			fprintf(logfd, "%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n", i, packet_ttime[i], packet_delay[i]);
-		}
-		fprintf(stderr, "\r> %s...DONE\n", cfg->logfile);
-	}
-
-	if (cfg->keepalive)
-		goto init_phase;
-
-cleanup:
-	close(sockfd);
-	close(heartfd);
-	free(packet_delay);
-	free(packet_ttime);
-}
-
-void run_server(struct config *cfg)
-{
-	static char ip[INET_ADDRSTRLEN];
-	static uint8_t zero_bytes[MAX_PKT_SIZE] = {0};
-
-	int sockfd = init_socket(&cfg->addr, true);
-	inet_ntop(AF_INET, &(cfg->addr.sin_addr), ip, INET_ADDRSTRLEN);
-	printf("> using %s:%d\n", ip, ntohs(cfg->addr.sin_port));
-
-	uint32_t           registered;
-
-	struct sockaddr_in *clients;
-	uint32_t           *counters;
-	uint64_t           *recvdata;
-
-	clients  = calloc(MAX_CLIENTS, sizeof(struct sockaddr_in));
-	counters = calloc(MAX_CLIENTS, sizeof(uint32_t));
-	recvdata = calloc(MAX_CLIENTS, sizeof(uint64_t));
-
-	if (clients == NULL || counters == NULL || recvdata == NULL) {
-		perror("run_server: failed to allocate buffers");
-		exit(1);
-	}
-
-init_phase:
-	{
-		struct sockaddr_in client;
-		static const char *MSG = "HELLO";
-		uint32_t i = 0;
-		struct timespec tp_now;
-		registered = 0;
-
-		clock_gettime(CLOCK_MONOTONIC, &tp_now);
-		while (registered < cfg->n_clients) {
-			if (clock_elapsed_sec(&tp_now) >= 1) {
-				clock_gettime(CLOCK_MONOTONIC, &tp_now);
-				fprintf(stderr, "\r> registering ");
-				fprintf(stderr, "%s [%u/%u]", SPINNER[i++ % 4], registered, cfg->n_clients);
-			}
-
-			if (read_message(sockfd, "HELLO", &client)) {
-				inet_ntop(AF_INET, &(client.sin_addr), ip, INET_ADDRSTRLEN);
-
-				fprintf(stderr, "\r> HELLO from %s\n", ip);
-				sendto(sockfd, MSG, strlen(MSG)+1, 0, (struct sockaddr*)&client, sizeof(struct sockaddr_in));
-
-				uint32_t idx;
-				for (idx = 0; idx < registered &&
-					!cmpaddr(clients + idx, &client);
-					++idx);
-
-				if (idx == registered) {
-					counters[registered] = 0;
-					recvdata[registered] = 0;
-					clients[registered++] = client;
-				}
-			}
-		}
-	}
-
-	usleep(500*1000);
-
-	{
-		static const char *MSG = "READY";
-		for (uint32_t i = 0; i < registered; ++i) {
-			sendto(sockfd, MSG, strlen(MSG)+1, 0, (struct sockaddr*)(clients + i), sizeof(struct sockaddr_in));
-		}
-	}
-
-	{
-		struct sockaddr_in client;
-		struct timespec    tp_now;
-		uint32_t i = registered;
-
-		clock_gettime(CLOCK_MONOTONIC, &tp_now);
-
-		while (clock_elapsed_sec(&tp_now) < 5 && i > 0) {
-			if (read_message(sockfd, "SETGO", &client)) {
-				i--;
-			}
-		}
-
-		if (i > 0) {
-			// system("./beep-error.exe");
-			goto cleanup;
-		}
-	}
-
-	{
-		for (int i = 0; i < registered; ++i) {
-			struct sockaddr_in *addr = clients + i;
-			uint32_t f = chash(addr);
-			inet_ntop(AF_INET, &(addr->sin_addr), ip, INET_ADDRSTRLEN);
-			printf("> [%d/%u (%u)] %s:%u %u\n", i+1, registered, f,
-				ip, ntohs(addr->sin_port), counters[f]);
-		}
-	}
-
-	{
-		struct timespec tp_start;
-		struct sockaddr addr;
-		socklen_t       fromlen = sizeof addr;
-
-		clock_gettime(CLOCK_MONOTONIC, &tp_start);
-		fprintf(stderr, "> running network test");
-		do {
-			int len = recvfrom(sockfd, zero_bytes, MAX_PKT_SIZE, 0, &addr, &fromlen);
-			if (len > 0) {
-				uint32_t f = chash((struct sockaddr_in *)&addr);
-				counters[f] = counters[f] + 1; //ntohl(packet);
-				recvdata[f] = recvdata[f] + len;
-			}
-		} while (clock_elapsed_sec(&tp_start) < cfg->testtime);
-		fprintf(stderr, "\r> network test completed\n");
-	}
-
-	usleep(500*1000);
-
-	{
-		for (int i = 0; i < registered; ++i) {
-			struct sockaddr_in *addr = clients + i;
-			uint32_t f = chash(addr);
-			inet_ntop(AF_INET, &(addr->sin_addr), ip, INET_ADDRSTRLEN);
-			printf("> [%d/%u (%u)] %s:%u %u pkts (%" PRIu64 " B)\n", i+1, registered, f,
-				ip, ntohs(addr->sin_port), counters[f], recvdata[f]);
-		}
-	}
-
-	{
-		static char     data[64000];
-		struct sockaddr addr;
-		int             len;
-		socklen_t       fromlen = sizeof addr;
-		uint32_t        consumed = 0;
-		do {
-			len = recvfrom(sockfd, data, 64000, 0, &addr, &fromlen);
-			if (len > 0) {
-				consumed++;
-			}
-		} while (len > 0);
-		printf("> consumed %u late packets\n", consumed);
-	}
-
-	if (cfg->keepalive) {
-		memset(clients, 0, MAX_CLIENTS * sizeof(struct sockaddr_in));
-		memset(counters, 0, MAX_CLIENTS * sizeof(uint32_t));
-		memset(recvdata, 0, MAX_CLIENTS * sizeof(uint64_t));
-		goto init_phase;
-	}
-
-cleanup:
-	free(counters);
-	free(clients);
-	close(sockfd);
-}
-
 void guard(const char *program, bool ensure, const char *msg)
 {
 	if (!ensure) {
@@ -528,32 +93,26 @@ void guard(const char *program, bool ensure, const char *msg)
 	}
 }
 
-bool parse_pdf(const char *pdf_arg, const char *cfg_arg, pdf_rv_fn *rv, pdf_cfg_t *cfg)
-{
-	if (strcmp("exp", pdf_arg) == 0) {
-		*rv = &exp_rvs;
-		if (!sscanf(cfg_arg, "y=%f", &cfg->exp.n))
-			return false;
-		return true;
-	}
-
-	if (strcmp("uniform", pdf_arg) == 0) {
-		*rv = &uniform_rvs;
+#define MAX_SWEEP (64)
 
-		if (!sscanf(cfg_arg, "n=%f,k=%f", &cfg->uniform.n, &cfg->uniform.k))
-			return false;
-
-		return true;
-	}
-
-	if (strcmp("weibull", pdf_arg) == 0) {
-		*rv = &exp_rvs;
-		if (!sscanf(cfg_arg, "a=%f,b=%f", &cfg->weibull.a, &cfg->weibull.b))
-			return false;
-		return true;
-	}
-
-	return false;
+/**
+ * comma separated list of at most MAX_SWEEP numbers, 0 if malformed
+ */
+uint32_t parse_list(const char *arg, double *v)
+{
+	uint32_t n = 0;
+	char *end;
+
+	do {
+		if (n == MAX_SWEEP)
+			return 0;
+		v[n++] = strtod(arg, &end);
+		if (end == arg || v[n-1] < 0)
+			return 0;
+		arg = end + 1;
+	} while (*end == ',');
+
+	return *end == '\0' ? n : 0;
 }
 
 // client.exe server.ip.addr.x
@@ -561,13 +120,16 @@ int main(int argc, char const *argv[])
 {
 	static const char *DEFAULT_LOGFILE = "logdata.csv";
 
-	struct config cfg;
-	memset(&cfg, 0, sizeof cfg);
+	static uint32_t sweep_sizes[MAX_SWEEP];
+	static double   sweep_rates[MAX_SWEEP];
+
+	struct jana_config cfg;
+	jana_config_init(&cfg);
 
-	cfg.testtime = 10;
 	cfg.logfile = DEFAULT_LOGFILE;
-	cfg.addr.sin_family = AF_INET;
-	cfg.addr.sin_port = htons(3000);
+	cfg.out = stdout;
+	cfg.log = stderr;
+	cfg.seed = time(NULL);
 
 	/* Parse options */
 	if (argc > 1) {
@@ -599,6 +161,10 @@ int main(int argc, char const *argv[])
 				exit(1);
 			}
 			// cfg.addr.sin_addr.s_addr = htonl(cfg.addr.sin_addr.s_addr);
+		} else if (strcmp("--clocktest", argv[j]) == 0) {
+			cfg.mode = jana_clocktest;
+		} else if (strcmp("--microbench", argv[j]) == 0) {
+			cfg.mode = jana_microbench;
 		} else if (strcmp("-x", argv[j]) == 0) {
 			cfg.mode = jana_dummy;
 
@@ -636,24 +202,187 @@ int main(int argc, char const *argv[])
 				strcmp("--rate", argv[j]) == 0) {
 
 				guard(argv[0], (j = j + 1) + 1 < argc, "must specify distribution and cfg");
-				if (!parse_pdf(argv[j], argv[j+1], &cfg.wait_rv, &cfg.wait_pdf)) {
+				if (!jana_parse_pdf(argv[j], argv[j+1], &cfg.wait_rv, &cfg.wait_pdf)) {
 					fprintf(stderr, "unknown distribution %s or config %s\n", argv[j], argv[j+1]);
 					exit(1);
 				}
+				cfg.wait_arg[0] = argv[j];
+				cfg.wait_arg[1] = argv[j+1];
 				j = j + 1;
 			} else if (strcmp("-d", argv[j]) == 0 ||
 				strcmp("--data", argv[j]) == 0) {
 
 				guard(argv[0], (j = j + 1) + 1 < argc, "must specify distribution and cfg");
-				if (!parse_pdf(argv[j], argv[j+1], &cfg.data_rv, &cfg.data_pdf)) {
+				if (!jana_parse_pdf(argv[j], argv[j+1], &cfg.data_rv, &cfg.data_pdf)) {
 					fprintf(stderr, "unknown distribution %s or config %s\n", argv[j], argv[j+1]);
 					exit(1);
 				}
+				cfg.data_arg[0] = argv[j];
+				cfg.data_arg[1] = argv[j+1];
 				j = j + 1;
 			} else if (strcmp("-l", argv[j]) == 0 ||
 				strcmp("--loop", argv[j]) == 0) {
 
 				cfg.keepalive = true;
+			} else if (strcmp("--sync", argv[j]) == 0) {
+
+				guard(argv[0], (j = j + 1) < argc, "must specify number of probes");
+				if (!sscanf(argv[j], "%u", &cfg.sync_probes)) {
+					fprintf(stderr, "invalid number: %s\n", argv[j]);
+					exit(1);
+				}
+			} else if (strcmp("--rt", argv[j]) == 0) {
+
+				guard(argv[0], (j = j + 1) < argc, "must specify cpu");
+				if (sscanf(argv[j], "%d,%d", &cfg.rt_cpu, &cfg.rt_prio) < 1 ||
+					cfg.rt_cpu < -1 || cfg.rt_cpu >= CPU_SETSIZE) {
+					fprintf(stderr, "invalid cpu: %s\n", argv[j]);
+					exit(1);
+				}
+				cfg.rt = true;
+			} else if (strcmp("--scenario", argv[j]) == 0) {
+
+				guard(argv[0], (j = j + 1) < argc, "must specify scenario file");
+				cfg.scenario = argv[j];
+			} else if (strcmp("--sockets", argv[j]) == 0) {
+
+				guard(argv[0], (j = j + 1) < argc, "must specify number of sockets");
+				if (!sscanf(argv[j], "%u", &cfg.n_sockets) || cfg.n_sockets == 0) {
+					fprintf(stderr, "invalid number: %s\n", argv[j]);
+					exit(1);
+				}
+			} else if (strcmp("--replay", argv[j]) == 0) {
+
+				guard(argv[0], (j = j + 1) < argc, "must specify schedule file");
+				cfg.replay = argv[j];
+			} else if (strcmp("--speed", argv[j]) == 0) {
+
+				guard(argv[0], (j = j + 1) < argc, "must specify speed factor");
+				if (!sscanf(argv[j], "%lf", &cfg.replay_speed) || cfg.replay_speed <= 0) {
+					fprintf(stderr, "invalid speed: %s\n", argv[j]);
+					exit(1);
+				}
+			} else if (strcmp("--pps", argv[j]) == 0) {
+
+				guard(argv[0], (j = j + 1) < argc, "must specify packets per second");
+				if (!sscanf(argv[j], "%lf", &cfg.replay_pps) || cfg.replay_pps <= 0) {
+					fprintf(stderr, "invalid rate: %s\n", argv[j]);
+					exit(1);
+				}
+			} else if (strcmp("--raw", argv[j]) == 0 ||
+				strcmp("--xdp", argv[j]) == 0) {
+
+				cfg.raw_xdp = strcmp("--xdp", argv[j]) == 0;
+				guard(argv[0], (j = j + 1) < argc, "must specify interface");
+				cfg.raw_if = argv[j];
+#ifndef JANA_XDP
+				guard(argv[0], !cfg.raw_xdp, "built without AF_XDP support");
+#endif
+			} else if (strcmp("--dst-mac", argv[j]) == 0) {
+
+				guard(argv[0], (j = j + 1) < argc, "must specify mac address");
+				cfg.raw_dst_mac = argv[j];
+			} else if (strcmp("--batch", argv[j]) == 0) {
+
+				guard(argv[0], (j = j + 1) < argc, "must specify batch size");
+				if (!sscanf(argv[j], "%u", &cfg.raw_batch) || cfg.raw_batch == 0) {
+					fprintf(stderr, "invalid number: %s\n", argv[j]);
+					exit(1);
+				}
+			} else if (strcmp("--burst-bin", argv[j]) == 0) {
+
+				guard(argv[0], (j = j + 1) < argc, "must specify bin width");
+				if (!sscanf(argv[j], "%u", &cfg.burst_bin_us) || cfg.burst_bin_us == 0) {
+					fprintf(stderr, "invalid number: %s\n", argv[j]);
+					exit(1);
+				}
+			} else if (strcmp("--store", argv[j]) == 0) {
+
+				guard(argv[0], (j = j + 1) < argc, "must specify result store");
+				cfg.store = argv[j];
+			} else if (strcmp("--label", argv[j]) == 0) {
+
+				guard(argv[0], (j = j + 1) < argc, "must specify label");
+				guard(argv[0], strpbrk(argv[j], " \t\n=") == NULL, "label must not contain blanks or '='");
+				cfg.label = argv[j];
+			} else if (strcmp("--verify", argv[j]) == 0) {
+
+				guard(argv[0], (j = j + 1) < argc, "must specify seed");
+				if (!sscanf(argv[j], "%u", &cfg.verify_seed)) {
+					fprintf(stderr, "invalid seed: %s\n", argv[j]);
+					exit(1);
+				}
+				cfg.verify = true;
+			} else if (strcmp("--sweep", argv[j]) == 0) {
+
+				double sizes[MAX_SWEEP];
+				guard(argv[0], (j = j + 1) + 1 < argc, "must specify sizes and rates");
+				cfg.n_sweep_sizes = parse_list(argv[j], sizes);
+				cfg.n_sweep_rates = parse_list(argv[j+1], sweep_rates);
+				if (cfg.n_sweep_sizes == 0 || cfg.n_sweep_rates == 0) {
+					fprintf(stderr, "invalid sweep: %s %s\n", argv[j], argv[j+1]);
+					exit(1);
+				}
+				for (uint32_t i = 0; i < cfg.n_sweep_sizes; ++i)
+					sweep_sizes[i] = (uint32_t)sizes[i];
+				cfg.sweep_sizes = sweep_sizes;
+				cfg.sweep_rates = sweep_rates;
+				j = j + 1;
+			} else if (strcmp("--warmup", argv[j]) == 0) {
+
+				guard(argv[0], (j = j + 1) < argc, "must specify milliseconds");
+				if (!sscanf(argv[j], "%u", &cfg.sweep_warmup_ms)) {
+					fprintf(stderr, "invalid number: %s\n", argv[j]);
+					exit(1);
+				}
+			} else if (strcmp("--sweep-json", argv[j]) == 0) {
+
+				guard(argv[0], (j = j + 1) < argc, "must specify path");
+				cfg.sweep_json = argv[j];
+			} else if (strcmp("--receivers", argv[j]) == 0) {
+
+				guard(argv[0], (j = j + 1) < argc, "must specify number of receivers");
+				if (!sscanf(argv[j], "%u", &cfg.receivers) || cfg.receivers == 0) {
+					fprintf(stderr, "invalid number: %s\n", argv[j]);
+					exit(1);
+				}
+			} else if (strcmp("--ttl", argv[j]) == 0) {
+
+				guard(argv[0], (j = j + 1) < argc, "must specify ttl");
+				if (!sscanf(argv[j], "%u", &cfg.mcast_ttl) || cfg.mcast_ttl > 255) {
+					fprintf(stderr, "invalid ttl: %s\n", argv[j]);
+					exit(1);
+				}
+			} else if (strcmp("--mcast-if", argv[j]) == 0) {
+
+				guard(argv[0], (j = j + 1) < argc, "must specify interface address");
+				if (inet_pton(AF_INET, argv[j], &cfg.mcast_if) <= 0) {
+					fprintf(stderr, "invalid ipv4 address: %s\n", argv[j]);
+					exit(1);
+				}
+			} else if (strcmp("--join", argv[j]) == 0) {
+
+				char group[INET_ADDRSTRLEN];
+				const char *comma;
+				guard(argv[0], (j = j + 1) < argc, "must specify group");
+				comma = strchr(argv[j], ',');
+				snprintf(group, sizeof group, "%.*s", comma ? (int)(comma - argv[j]) : (int)strlen(argv[j]), argv[j]);
+				if (inet_pton(AF_INET, group, &cfg.join_group) <= 0 ||
+					!IN_MULTICAST(ntohl(cfg.join_group.s_addr)) ||
+					(comma != NULL && inet_pton(AF_INET, comma + 1, &cfg.join_if) <= 0)) {
+					fprintf(stderr, "invalid multicast group or interface: %s\n", argv[j]);
+					exit(1);
+				}
+				cfg.join = true;
+			} else if (strcmp("--tcp", argv[j]) == 0) {
+
+				cfg.tcp = true;
+			} else if (strcmp("--overhead", argv[j]) == 0) {
+
+				cfg.overhead = true;
+			} else if (strcmp("--perf", argv[j]) == 0) {
+
+				cfg.perf = true;
 			} else if (strcmp("-t", argv[j]) == 0 ||
 				strcmp("--time", argv[j]) == 0) {
 
@@ -673,16 +402,65 @@ int main(int argc, char const *argv[])
 		};
 	}
 
-	srand(time(NULL));
+	if (cfg.tcp && cfg.scenario != NULL) {
+		fprintf(stderr, "%s: --tcp cannot be combined with --scenario\n", argv[0]);
+		exit(1);
+	}
+
+	if (cfg.raw_if != NULL && (cfg.tcp || cfg.scenario != NULL)) {
+		fprintf(stderr, "%s: --raw/--xdp cannot be combined with --tcp or --scenario\n", argv[0]);
+		exit(1);
+	}
+
+	if (cfg.verify && (cfg.tcp || cfg.raw_if != NULL || cfg.scenario != NULL)) {
+		fprintf(stderr, "%s: --verify only works with the udp socket path\n", argv[0]);
+		exit(1);
+	}
+
+	if (IN_MULTICAST(ntohl(cfg.addr.sin_addr.s_addr)) && cfg.mode != jana_server &&
+		(cfg.tcp || cfg.raw_if != NULL || cfg.scenario != NULL || cfg.verify || cfg.n_sweep_sizes > 0)) {
+		fprintf(stderr, "%s: a multicast client cannot use --tcp, --raw, --scenario, --verify or --sweep\n", argv[0]);
+		exit(1);
+	}
+
+	if (cfg.join && (cfg.mode != jana_server || cfg.tcp)) {
+		fprintf(stderr, "%s: --join is a udp server option\n", argv[0]);
+		exit(1);
+	}
+
+	if (cfg.n_sweep_sizes > 0 && (cfg.mode != jana_client || cfg.tcp || cfg.raw_if != NULL ||
+		cfg.scenario != NULL || cfg.replay != NULL)) {
+		fprintf(stderr, "%s: --sweep is a udp client mode without --tcp, --raw, --scenario or --replay\n", argv[0]);
+		exit(1);
+	}
 
-	if (cfg.mode == jana_client ||
-		cfg.mode == jana_dummy) {
-		run_client(&cfg);
+	if (cfg.n_sweep_sizes > 0 && cfg.logfile != DEFAULT_LOGFILE) {
+		fprintf(stderr, "%s: --sweep writes no packet log, use --sweep-json instead of -f\n", argv[0]);
+		exit(1);
 	}
 
-	if (cfg.mode == jana_server) {
-		run_server(&cfg);
+	if (cfg.mode == jana_clocktest) {
+		jana_print_clocktest(stdout);
+		return 0;
 	}
 
-	return 0;
+	if (cfg.mode == jana_microbench) {
+		jana_print_microbench(stdout);
+		return 0;
+	}
+
+	// the library only touches the test thread, page locking is process-wide
+	if (cfg.rt && mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+		perror("mlockall");
+
+	struct jana *j = jana_create(&cfg);
+	if (j == NULL) {
+		perror("jana_create");
+		exit(1);
+	}
+
+	int result = jana_run(j);
+	jana_destroy(j);
+
+	return result == 0 ? 0 : 1;
 }
@@ -0,0 +1,211 @@
+#ifndef JANA_H
+#define JANA_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <netinet/in.h>
+
+//
+// LIBJANA
+//
+// the traffic generator (client) and receiver (server) of jana as a
+// library. an instance is created from a config, run in the calling
+// thread (jana_run) or a thread of its own (jana_start), and can be
+// polled for counters and histograms from any other thread meanwhile.
+// instances share no mutable state, several can run in one process.
+//
+//   struct jana_config cfg;
+//   jana_config_init(&cfg);
+//   cfg.mode = jana_server;
+//   cfg.n_clients = 1;
+//
+//   struct jana *rx = jana_create(&cfg);
+//   jana_start(rx);
+//   ...
+//   jana_stats(rx, &stats);
+//   jana_stop(rx);
+//   jana_wait(rx);
+//   jana_destroy(rx);
+//
+
+/**
+ * random variates, "fn" and "k1=v1,k2=v2" as on the command line
+ */
+typedef union pdf_cfg_s
+{
+	struct uniform
+	{
+		float n;
+		float k;
+	} uniform;
+
+	struct exp
+	{
+		float n;
+	} exp;
+
+	struct weibull
+	{
+		float a;
+		float b;
+	} weibull;
+} pdf_cfg_t;
+
+typedef float (*pdf_rv_fn)(pdf_cfg_t*, unsigned int *seed);
+
+bool jana_parse_pdf(const char *pdf_arg, const char *cfg_arg, pdf_rv_fn *rv, pdf_cfg_t *cfg);
+
+enum jana_mode { jana_decide, jana_client, jana_server, jana_dummy, jana_clocktest, jana_microbench };
+
+struct jana_config
+{
+	enum     jana_mode 		mode;
+	struct   sockaddr_in 	addr;
+
+	pdf_rv_fn				wait_rv;
+	pdf_rv_fn				data_rv;
+
+	pdf_cfg_t 				wait_pdf;
+	pdf_cfg_t 				data_pdf;
+
+	const char *wait_arg[2];  /* fn and cfg as given, for the store */
+	const char *data_arg[2];
+
+	uint32_t n_clients;
+	bool 	 keepalive;
+	int 	 testtime;
+	uint32_t sync_probes;
+
+	bool     rt;              /* the test thread only, see jana_run */
+	int      rt_cpu;          /* -1: any */
+	int      rt_prio;         /* SCHED_FIFO */
+
+	bool     overhead;
+	bool     perf;
+
+	const char *scenario;
+	uint32_t    n_sockets;
+
+	const char *replay;
+	double      replay_speed;
+	double      replay_pps;
+
+	bool     tcp;
+	uint32_t burst_bin_us;
+
+	bool     verify;
+	uint32_t verify_seed;
+
+	uint32_t       receivers;     /* multicast client: servers to wait for */
+	uint32_t       mcast_ttl;
+	struct in_addr mcast_if;      /* sending interface address, 0 for the route's */
+	bool           join;          /* server: receive join_group on join_if */
+	struct in_addr join_group;
+	struct in_addr join_if;
+
+	const uint32_t *sweep_sizes;  /* udp payload bytes */
+	const double   *sweep_rates;  /* pps, 0 for unpaced */
+	uint32_t    n_sweep_sizes;    /* 0: no sweep */
+	uint32_t    n_sweep_rates;
+	uint32_t    sweep_warmup_ms;
+	const char *sweep_json;       /* NULL: table on out only */
+
+	const char *raw_if;
+	bool        raw_xdp;
+	const char *raw_dst_mac;
+	uint32_t    raw_batch;
+
+	const char *logfile;      /* client packet log, NULL for none; not written by sweeps */
+	const char *store;
+	const char *label;
+
+	FILE        *out;         /* reports, NULL for none */
+	FILE        *log;         /* progress and error messages, NULL for none */
+	unsigned int seed;        /* random variates, 0 picks one */
+};
+
+/**
+ * defaults of the command line: 10 s tests on port 3000, 16 sync probes
+ */
+void jana_config_init(struct jana_config *cfg);
+
+/**
+ * log-linear histogram: every power of two is split into 4 buckets, so
+ * any value is known to within 25%. values below 4 are exact.
+ */
+#define JANA_HIST_BUCKETS (256)
+
+struct jana_hist
+{
+	uint64_t count;
+	uint64_t sum;
+	uint64_t min;
+	uint64_t max;
+	uint64_t bucket[JANA_HIST_BUCKETS];
+};
+
+uint64_t jana_hist_quantile(const struct jana_hist *h, double q);
+
+enum jana_hist_id
+{
+	JANA_HIST_SEND,       /* client: sendto duration, ns */
+	JANA_HIST_PACING,     /* client: departure behind schedule, ns */
+	JANA_HIST_GAP,        /* server: inter-arrival time, ns */
+	JANA_HIST_SIZE,       /* server: datagram size, bytes */
+	JANA_HIST_LATENCY,    /* server: tcp message latency, ns */
+	JANA_HIST_COUNT
+};
+
+/**
+ * live counters, summed over all clients of a server. they cover the
+ * test in progress, or the last one between tests.
+ */
+struct jana_stats
+{
+	uint64_t tests;       /* completed tests */
+	bool     in_test;
+	uint64_t tx_pkts;
+	uint64_t tx_bytes;
+	uint64_t tx_errors;
+	uint64_t rx_pkts;
+	uint64_t rx_bytes;
+	uint64_t rx_lost;
+	uint64_t rx_reordered;
+	uint64_t rx_corrupt;
+};
+
+struct jana;
+
+/**
+ * NULL and errno set if the config cannot work (EINVAL), on ENOMEM, or
+ * EIO if verify is set and the crc32c self-check failed
+ */
+struct jana *jana_create(const struct jana_config *cfg);
+
+/**
+ * run in the calling thread until done, or stopped by jana_stop from
+ * another thread. 0 on success, -1 if setting up the test failed.
+ * with rt set the calling thread is pinned to rt_cpu and runs SCHED_FIFO
+ * from then on; nothing process-wide is changed, so locking memory
+ * (mlockall) is left to the application.
+ */
+int  jana_run(struct jana *j);
+
+int  jana_start(struct jana *j);
+void jana_stop(struct jana *j);
+int  jana_wait(struct jana *j);
+void jana_destroy(struct jana *j);
+
+void jana_stats(struct jana *j, struct jana_stats *out);
+
+/**
+ * clients publish their histograms after every test, servers also
+ * every 100 ms during one. false for a histogram the mode has not.
+ */
+bool jana_hist(struct jana *j, enum jana_hist_id id, struct jana_hist *out);
+
+void jana_print_clocktest(FILE *out);
+void jana_print_microbench(FILE *out);
+
+#endif
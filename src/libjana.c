@@ -0,0 +1,4314 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <math.h>
+
+#define MAX_PACKETS (5000000)
+#define MAX_CLIENTS (256)
+#define MAX_CLASSES (64)
+#define MAX_FLOWS   (1 << 20)
+
+#include <linux/net_tstamp.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <net/if.h>
+#include <net/ethernet.h>
+#include <linux/if_packet.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <sys/utsname.h>
+#include <linux/perf_event.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/if_xdp.h>)
+#include <linux/if_xdp.h>
+#define JANA_XDP
+#endif
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+
+#if defined(__aarch64__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "jana.h"
+#include "schedule.h"
+
+#define MAX_PKT_SIZE (64100)
+
+// receive loop iterations between two test deadline checks
+#define TICK_CHECK_EVERY (64)
+
+
+static float rand1(unsigned int *seed) { return ((float)rand_r(seed))/((float)(RAND_MAX)+1); }
+
+static float uniform_rvs(pdf_cfg_t *cfg, unsigned int *seed)
+{
+	return cfg->uniform.n * rand1(seed) + cfg->uniform.k;
+}
+
+static float exp_rvs(pdf_cfg_t *cfg, unsigned int *seed)
+{
+	float x = rand1(seed);
+	return -cfg->exp.n * log(1.0 - x);
+}
+// x = −(1/β)*ln(α∏i=1(Ui))
+static float weibull_rvs(pdf_cfg_t *cfg, unsigned int *seed)
+{
+	float x = rand1(seed);
+	float i = cfg->weibull.a - 1.0;
+	while (i-- >= 1) {
+		x *= rand1(seed);
+	}
+	return -(1.0/cfg->weibull.b) * log(x);
+}
+
+bool jana_parse_pdf(const char *pdf_arg, const char *cfg_arg, pdf_rv_fn *rv, pdf_cfg_t *cfg)
+{
+	if (strcmp("exp", pdf_arg) == 0) {
+		*rv = &exp_rvs;
+		if (!sscanf(cfg_arg, "y=%f", &cfg->exp.n))
+			return false;
+		return true;
+	}
+
+	if (strcmp("uniform", pdf_arg) == 0) {
+		*rv = &uniform_rvs;
+
+		if (!sscanf(cfg_arg, "n=%f,k=%f", &cfg->uniform.n, &cfg->uniform.k))
+			return false;
+
+		return true;
+	}
+
+	if (strcmp("weibull", pdf_arg) == 0) {
+		*rv = &exp_rvs;
+		if (!sscanf(cfg_arg, "a=%f,b=%f", &cfg->weibull.a, &cfg->weibull.b))
+			return false;
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * perror() into the instance's log, errno is left as it was
+ */
+static void log_perror(FILE *log, const char *what)
+{
+	int err = errno;
+	fprintf(log, "%s: %s\n", what, strerror(err));
+	errno = err;
+}
+
+/**
+ * hash a client's ip
+ */
+static uint32_t chash(struct sockaddr_in *sa)
+{
+	uint32_t addr = sa->sin_addr.s_addr;
+	return addr >> 24;
+
+}
+
+static double clock_elapsed_sec(struct timespec *c)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (c != NULL)
+		now.tv_sec -= c->tv_sec;
+	return (double)(now.tv_sec);
+}
+
+static int64_t clock_now_ns(clockid_t clk)
+{
+	struct timespec now;
+	clock_gettime(clk, &now);
+	return (int64_t)(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * cheap timestamps for the hot loops. ticks come from the invariant TSC on
+ * x86, the virtual counter on aarch64, or the vDSO monotonic clock when
+ * neither can be trusted. they are converted to wall time only when the
+ * log is written, interpolating between (tick, CLOCK_REALTIME) pairs taken
+ * before and after each test, so neither calibration error nor slewing
+ * of the wall clock piles up over a long test. timestamps that leave the
+ * host are taken from CLOCK_REALTIME directly. the calibration is done
+ * once per process and only read afterwards.
+ */
+enum tick_source { tick_vdso, tick_tsc, tick_cntvct };
+
+static const char *TICK_SOURCE_NAME[] = { "vdso", "tsc", "cntvct" };
+
+struct tick_clock
+{
+	enum tick_source source;
+	double   ns_per_tick;
+};
+
+static struct tick_clock ticks = { tick_vdso, 1.0 };
+
+struct tick_base
+{
+	uint64_t tick;
+	int64_t  wall_ns;
+	double   ns_per_tick;    /* between the two pairings once the test ended */
+};
+
+static inline uint64_t tick_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	if (ticks.source == tick_tsc)
+		return __rdtsc();
+#elif defined(__aarch64__)
+	if (ticks.source == tick_cntvct) {
+		uint64_t v;
+		__asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r"(v));
+		return v;
+	}
+#endif
+	return (uint64_t)clock_now_ns(CLOCK_MONOTONIC);
+}
+
+static inline uint64_t tick_from_ns(uint64_t ns)
+{
+	return (uint64_t)(ns / ticks.ns_per_tick);
+}
+
+static inline uint64_t tick_to_ns(uint64_t t)
+{
+	return (uint64_t)(t * ticks.ns_per_tick);
+}
+
+static int64_t tick_to_wall_ns(const struct tick_base *b, uint64_t t)
+{
+	int64_t dt = (int64_t)(t - b->tick);
+	return b->wall_ns + (int64_t)(dt * b->ns_per_tick);
+}
+
+static uint64_t tick_from_wall_ns(const struct tick_base *b, int64_t wall_ns)
+{
+	return b->tick + (uint64_t)((wall_ns - b->wall_ns) / b->ns_per_tick);
+}
+
+static uint64_t tick_to_wall_us(const struct tick_base *b, uint64_t t)
+{
+	return (uint64_t)(tick_to_wall_ns(b, t) / 1000);
+}
+
+/**
+ * pair the tick counter with a clock, taking the tightest of a few
+ * bracketing reads
+ */
+static void tick_pair(clockid_t clk, uint64_t *tick, int64_t *ns)
+{
+	uint64_t best = UINT64_MAX;
+
+	for (int i = 0; i < 5; ++i) {
+		uint64_t a = tick_now();
+		int64_t wall = clock_now_ns(clk);
+		uint64_t b = tick_now();
+		if (b - a < best) {
+			best = b - a;
+			*tick = a + (b - a) / 2;
+			*ns = wall;
+		}
+	}
+}
+
+/**
+ * pairing before a test; until the test ends ticks are extrapolated at
+ * the calibrated rate
+ */
+static void tick_rebase(struct tick_base *base)
+{
+	tick_pair(CLOCK_REALTIME, &base->tick, &base->wall_ns);
+	base->ns_per_tick = ticks.ns_per_tick;
+}
+
+/**
+ * pairing after a test: the rate between the two pairings replaces the
+ * calibrated one, so the whole test maps onto the wall clock exactly
+ */
+static void tick_rebase_end(struct tick_base *base)
+{
+	uint64_t tick;
+	int64_t wall_ns;
+
+	tick_pair(CLOCK_REALTIME, &tick, &wall_ns);
+	if (tick > base->tick && wall_ns > base->wall_ns)
+		base->ns_per_tick = (double)(wall_ns - base->wall_ns) / (double)(tick - base->tick);
+}
+
+/**
+ * sleep until an absolute tick, spinning the last stretch since usleep()
+ * overshoots by tens of microseconds
+ */
+static void tick_sleep_until(uint64_t due)
+{
+	uint64_t now = tick_now();
+	uint64_t margin = tick_from_ns(100000);
+
+	if (due > now + margin)
+		usleep(tick_to_ns(due - now - margin) / 1000);
+
+	while (tick_now() < due);
+}
+
+static void tick_calibrate(void)
+{
+	ticks.source = tick_vdso;
+	ticks.ns_per_tick = 1.0;
+
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned int eax, ebx, ecx, edx;
+	if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1 << 8)))
+		ticks.source = tick_tsc;
+#elif defined(__aarch64__)
+	ticks.source = tick_cntvct;
+#endif
+
+	// bracketed pairings 200 ms apart put the rate within a fraction of a ppm
+	if (ticks.source != tick_vdso) {
+		uint64_t t0, t1;
+		int64_t  ns0, ns1;
+
+		tick_pair(CLOCK_MONOTONIC, &t0, &ns0);
+		usleep(200*1000);
+		tick_pair(CLOCK_MONOTONIC, &t1, &ns1);
+
+		if (t1 > t0)
+			ticks.ns_per_tick = (double)(ns1 - ns0) / (double)(t1 - t0);
+		else
+			ticks.source = tick_vdso;
+	}
+}
+
+static void jana_init(void);
+
+/**
+ * report resolution and per-call cost of the tick source next to the
+ * plain clock_gettime calls it replaces
+ */
+void jana_print_clocktest(FILE *out)
+{
+	enum { CALLS = 1000000 };
+	volatile uint64_t sink = 0;
+
+	jana_init();
+
+	fprintf(out, "> tick source %s, %.4f ns/tick\n", TICK_SOURCE_NAME[ticks.source], ticks.ns_per_tick);
+
+	{
+		uint64_t res = UINT64_MAX;
+		for (int i = 0; i < 1000; ++i) {
+			uint64_t a = tick_now(), b;
+			while ((b = tick_now()) == a);
+			if (b - a < res)
+				res = b - a;
+		}
+		fprintf(out, "> tick resolution %.1f ns\n", tick_to_ns(res) + 0.0);
+	}
+
+	{
+		uint64_t a = tick_now();
+		for (int i = 0; i < CALLS; ++i)
+			sink += tick_now();
+		uint64_t b = tick_now();
+		fprintf(out, "> tick_now       %6.1f ns/call\n", (double)tick_to_ns(b - a) / CALLS);
+	}
+
+	static const clockid_t CLOCKS[] = { CLOCK_MONOTONIC, CLOCK_REALTIME };
+	static const char *CLOCK_NAME[] = { "monotonic", "realtime" };
+	for (int c = 0; c < 2; ++c) {
+		struct timespec tp;
+		uint64_t a = tick_now();
+		for (int i = 0; i < CALLS; ++i) {
+			clock_gettime(CLOCKS[c], &tp);
+			sink += tp.tv_nsec;
+		}
+		uint64_t b = tick_now();
+		fprintf(out, "> %-14s %6.1f ns/call\n", CLOCK_NAME[c], (double)tick_to_ns(b - a) / CALLS);
+	}
+
+	(void)sink;
+}
+
+/**
+ * one generator or receiver. everything a running test touches lives
+ * here, so instances on different threads share nothing but the tick
+ * calibration. the live counters are written by the instance's thread
+ * only and read with relaxed atomics by whoever polls; histograms are
+ * copied in and out under the lock.
+ */
+struct live
+{
+	_Atomic uint64_t tests;
+	atomic_bool      in_test;
+	_Atomic uint64_t tx_pkts;
+	_Atomic uint64_t tx_bytes;
+	_Atomic uint64_t tx_errors;
+	_Atomic uint64_t rx_pkts;
+	_Atomic uint64_t rx_bytes;
+	_Atomic uint64_t rx_lost;
+	_Atomic uint64_t rx_reordered;
+	_Atomic uint64_t rx_corrupt;
+};
+
+struct jana
+{
+	struct jana_config cfg;
+	FILE              *devnull;
+	unsigned int       seed;
+	struct tick_base   base;
+
+	pthread_t          thread;
+	bool               started;
+	int                result;
+	atomic_bool        stop;
+
+	struct live        live;
+	pthread_mutex_t    lock;
+	struct jana_hist   hist[JANA_HIST_COUNT];
+	bool               has_hist[JANA_HIST_COUNT];
+
+	uint8_t            buf[MAX_PKT_SIZE];
+};
+
+// interval between two histogram snapshots of a running server
+#define PUBLISH_NS (100 * 1000 * 1000)
+
+static inline bool stopping(struct jana *j)
+{
+	return atomic_load_explicit(&j->stop, memory_order_relaxed);
+}
+
+static inline void live_set(_Atomic uint64_t *c, uint64_t v)
+{
+	atomic_store_explicit(c, v, memory_order_relaxed);
+}
+
+static void publish_hist(struct jana *j, enum jana_hist_id id, const struct jana_hist *h)
+{
+	pthread_mutex_lock(&j->lock);
+	j->hist[id] = *h;
+	j->has_hist[id] = true;
+	pthread_mutex_unlock(&j->lock);
+}
+
+/**
+ * ntp-style clock offset estimate of the server relative to the client,
+ * taken from the probe with the smallest round trip. all times are ns
+ * of CLOCK_REALTIME; the true offset lies within offset_ns +- error_ns.
+ */
+struct clock_sync
+{
+	bool    valid;
+	int64_t offset_ns;
+	int64_t error_ns;
+	int64_t rtt_ns;
+	int64_t ref_ns;     /* client time the estimate refers to */
+	uint32_t probes;
+};
+
+/**
+ * linear clock model built from the estimates before and after a test,
+ * server_time(t) = t + offset_ns + drift * (t - ref_ns)
+ */
+struct clock_model
+{
+	bool    valid;
+	int64_t offset_ns;
+	int64_t error_ns;
+	int64_t ref_ns;
+	double  drift;
+	double  drift_error;
+};
+
+
+/**
+ * real-time mode: pin the calling (hot) thread and switch it to
+ * SCHED_FIFO. only this thread changes, locking memory is left to the
+ * application (the cli does it for --rt), the buffers are prefaulted
+ * instead. each step is best effort since SCHED_FIFO needs privileges;
+ * what was achieved is printed.
+ */
+static void rt_enter(struct jana_config *cfg)
+{
+	const char *pin = "unpinned", *sched = "SCHED_OTHER";
+	int err;
+
+	if (cfg->rt_cpu >= 0) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cfg->rt_cpu, &set);
+		if ((err = pthread_setaffinity_np(pthread_self(), sizeof set, &set)) == 0)
+			pin = "pinned";
+		else
+			fprintf(cfg->log, "rt_enter: pthread_setaffinity_np: %s\n", strerror(err));
+	}
+
+	struct sched_param sp = { .sched_priority = cfg->rt_prio };
+	if ((err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp)) == 0)
+		sched = "SCHED_FIFO";
+	else
+		fprintf(cfg->log, "rt_enter: pthread_setschedparam: %s\n", strerror(err));
+
+	fprintf(cfg->log, "> rt: cpu %d %s, %s %d\n", cfg->rt_cpu, pin, sched, cfg->rt_prio);
+}
+
+/**
+ * touch every page of a buffer so the test loop never takes a fault on it
+ */
+static void rt_prefault(void *buf, size_t len)
+{
+	volatile uint8_t *p = buf;
+	long page = sysconf(_SC_PAGESIZE);
+
+	for (size_t i = 0; i < len; i += page)
+		p[i] = p[i];
+	if (len > 0)
+		p[len-1] = p[len-1];
+}
+
+enum { RT_CTXSW, RT_FAULTS, RT_MIGRATIONS, RT_COUNTERS };
+
+/**
+ * scheduling noise observed by this thread during the test window
+ */
+struct rt_window
+{
+	struct rusage ru;
+	int      perf_fd[RT_COUNTERS];
+};
+
+static int perf_open(uint32_t type, uint64_t config)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof attr);
+	attr.size     = sizeof attr;
+	attr.type     = type;
+	attr.config   = config;
+	attr.disabled = 1;
+
+	return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t perf_read(int fd)
+{
+	uint64_t value = 0;
+	if (fd < 0 || read(fd, &value, sizeof value) != sizeof value)
+		return 0;
+	return value;
+}
+
+static void rt_window_begin(struct rt_window *w)
+{
+	static const uint64_t SW[RT_COUNTERS] = {
+		PERF_COUNT_SW_CONTEXT_SWITCHES,
+		PERF_COUNT_SW_PAGE_FAULTS,
+		PERF_COUNT_SW_CPU_MIGRATIONS
+	};
+
+	for (int i = 0; i < RT_COUNTERS; ++i) {
+		w->perf_fd[i] = perf_open(PERF_TYPE_SOFTWARE, SW[i]);
+		if (w->perf_fd[i] >= 0)
+			ioctl(w->perf_fd[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+
+	getrusage(RUSAGE_THREAD, &w->ru);
+}
+
+static void rt_window_end(struct rt_window *w, FILE *out)
+{
+	struct rusage ru;
+	uint64_t perf[RT_COUNTERS];
+
+	getrusage(RUSAGE_THREAD, &ru);
+
+	for (int i = 0; i < RT_COUNTERS; ++i) {
+		if (w->perf_fd[i] >= 0)
+			ioctl(w->perf_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+		perf[i] = perf_read(w->perf_fd[i]);
+	}
+
+	fprintf(out, "> rt window: %ld ctx switches (%ld voluntary, %ld involuntary), "
+		"%ld page faults (%ld major)",
+		(ru.ru_nvcsw - w->ru.ru_nvcsw) + (ru.ru_nivcsw - w->ru.ru_nivcsw),
+		ru.ru_nvcsw - w->ru.ru_nvcsw, ru.ru_nivcsw - w->ru.ru_nivcsw,
+		(ru.ru_minflt - w->ru.ru_minflt) + (ru.ru_majflt - w->ru.ru_majflt),
+		ru.ru_majflt - w->ru.ru_majflt);
+
+	if (w->perf_fd[RT_MIGRATIONS] >= 0)
+		fprintf(out, ", %" PRIu64 " migrations", perf[RT_MIGRATIONS]);
+	else
+		fprintf(out, ", migrations n/a");
+
+	if (w->perf_fd[RT_CTXSW] >= 0)
+		fprintf(out, " [perf: %" PRIu64 " cs, %" PRIu64 " faults]",
+			perf[RT_CTXSW], perf[RT_FAULTS]);
+	fprintf(out, "\n");
+
+	for (int i = 0; i < RT_COUNTERS; ++i)
+		if (w->perf_fd[i] >= 0)
+			close(w->perf_fd[i]);
+}
+
+/**
+ * hardware counters of this thread over the test phase (--perf)
+ */
+enum { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_CACHE_MISSES, PERF_COUNTERS };
+
+struct perf_window
+{
+	int fd[PERF_COUNTERS];
+};
+
+static void perf_window_begin(struct perf_window *w, FILE *log)
+{
+	static const uint64_t HW[PERF_COUNTERS] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES
+	};
+
+	for (int i = 0; i < PERF_COUNTERS; ++i) {
+		w->fd[i] = perf_open(PERF_TYPE_HARDWARE, HW[i]);
+		if (w->fd[i] >= 0)
+			ioctl(w->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+
+	if (w->fd[PERF_CYCLES] < 0)
+		log_perror(log, "perf_window_begin: perf_event_open");
+}
+
+static void perf_window_end(struct perf_window *w, FILE *out)
+{
+	uint64_t v[PERF_COUNTERS];
+
+	for (int i = 0; i < PERF_COUNTERS; ++i) {
+		if (w->fd[i] >= 0)
+			ioctl(w->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+		v[i] = perf_read(w->fd[i]);
+		if (w->fd[i] >= 0)
+			close(w->fd[i]);
+	}
+
+	if (w->fd[PERF_CYCLES] < 0) {
+		fprintf(out, "> perf: counters not available\n");
+		return;
+	}
+
+	fprintf(out, "> perf: %" PRIu64 " cycles, %" PRIu64 " instructions (%.2f ipc), %" PRIu64 " cache misses\n",
+		v[PERF_CYCLES], v[PERF_INSTRUCTIONS],
+		v[PERF_CYCLES] ? (double)v[PERF_INSTRUCTIONS] / v[PERF_CYCLES] : 0.0,
+		v[PERF_CACHE_MISSES]);
+}
+
+/**
+ * histograms, see struct jana_hist
+ */
+#define HIST_BUCKETS JANA_HIST_BUCKETS
+
+static inline uint32_t hist_index(uint64_t v)
+{
+	if (v < 4)
+		return (uint32_t)v;
+
+	uint32_t msb = 63 - __builtin_clzll(v);
+	return (msb - 1) * 4 + ((v >> (msb - 2)) & 3);
+}
+
+static inline uint64_t hist_lower(uint32_t idx)
+{
+	if (idx < 4)
+		return idx;
+
+	uint32_t msb = idx / 4 + 1;
+	return (uint64_t)(4 + idx % 4) << (msb - 2);
+}
+
+static void hist_reset(struct jana_hist *h)
+{
+	memset(h, 0, sizeof *h);
+	h->min = UINT64_MAX;
+}
+
+static inline void hist_add(struct jana_hist *h, uint64_t v)
+{
+	h->bucket[hist_index(v)]++;
+	h->count++;
+	h->sum += v;
+	if (v < h->min)
+		h->min = v;
+	if (v > h->max)
+		h->max = v;
+}
+
+static void hist_merge(struct jana_hist *dst, const struct jana_hist *src)
+{
+	for (uint32_t i = 0; i < HIST_BUCKETS; ++i)
+		dst->bucket[i] += src->bucket[i];
+	dst->count += src->count;
+	dst->sum += src->sum;
+	if (src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+
+/**
+ * value at quantile q, reported as the midpoint of its bucket
+ */
+uint64_t jana_hist_quantile(const struct jana_hist *h, double q)
+{
+	if (h->count == 0)
+		return 0;
+
+	uint64_t rank = (uint64_t)(q * (h->count - 1)) + 1, seen = 0;
+
+	for (uint32_t i = 0; i < HIST_BUCKETS; ++i) {
+		seen += h->bucket[i];
+		if (seen >= rank) {
+			uint64_t lo = hist_lower(i);
+			uint64_t hi = i + 1 < HIST_BUCKETS ? hist_lower(i + 1) : lo;
+			uint64_t mid = lo + (hi - lo) / 2;
+			return mid < h->min ? h->min : mid > h->max ? h->max : mid;
+		}
+	}
+	return h->max;
+}
+
+/**
+ * one line summary of a histogram of ns values, printed in us
+ */
+static void hist_print_unit(FILE *out, const char *name, struct jana_hist *h, double div, const char *unit)
+{
+	if (h->count == 0) {
+		fprintf(out, ">   %-14s no samples\n", name);
+		return;
+	}
+
+	fprintf(out, ">   %-14s n=%" PRIu64 " mean %.2f p50 %.2f p90 %.2f p99 %.2f max %.2f %s\n",
+		name, h->count, (double)h->sum / h->count / div,
+		jana_hist_quantile(h, 0.50) / div, jana_hist_quantile(h, 0.90) / div,
+		jana_hist_quantile(h, 0.99) / div, h->max / div, unit);
+}
+
+static void hist_print(FILE *out, const char *name, struct jana_hist *h)
+{
+	hist_print_unit(out, name, h, 1000.0, "us");
+}
+
+/**
+ * shape of the traffic as it arrives from one client: inter-arrival gaps,
+ * datagram sizes and microbursts. the peak is the most traffic in any
+ * window of one bin width, sliding with every arrival. for bursts the
+ * arrivals are binned into `bin` ticks; a burst is a run of consecutive
+ * bins holding more than one packet and more than BURST_FACTOR times the
+ * mean packets per bin so far, so a steady stream has none however fast
+ * it is.
+ */
+#define ARRIVAL_WINDOW (1024)
+#define BURST_FACTOR   (2)
+
+struct arrival
+{
+	struct jana_hist gap;     /* ns */
+	struct jana_hist size;    /* bytes */
+	struct jana_hist burst;   /* ns */
+	struct jana_hist delay;   /* ns, multicast send stamp to arrival */
+	uint64_t    delay_negative; /* arrivals stamped before they were sent */
+	uint64_t    first;
+	uint64_t    last;
+	uint64_t    bin;
+	uint64_t    binned;       /* packets up to and including the open bin */
+	uint32_t    bin_pkts;
+	uint32_t    win_head;     /* oldest arrival in the sliding window */
+	uint32_t    win_pkts;
+	uint32_t    win_bytes;
+	uint32_t    peak_pkts;
+	uint32_t    peak_bytes;
+	bool        peak_capped;  /* the window outgrew ARRIVAL_WINDOW */
+	uint32_t    burst_bins;
+	uint32_t    burst_pkts;
+	uint32_t    peak_burst_pkts;
+	uint32_t    next_id;      /* highest packet id seen + 1 */
+	uint64_t    pkts;
+	uint64_t    reordered;
+	struct {
+		uint64_t tick;
+		uint32_t len;
+	} win[ARRIVAL_WINDOW];
+};
+
+static void arrival_reset(struct arrival *a)
+{
+	hist_reset(&a->gap);
+	hist_reset(&a->size);
+	hist_reset(&a->burst);
+	hist_reset(&a->delay);
+	a->delay_negative = 0;
+	a->last = a->bin = a->binned = 0;
+	a->bin_pkts = a->peak_pkts = a->peak_bytes = 0;
+	a->win_head = a->win_pkts = a->win_bytes = 0;
+	a->peak_capped = false;
+	a->burst_bins = a->burst_pkts = a->peak_burst_pkts = 0;
+	a->first = a->last = 0;
+	a->next_id = 0;
+	a->pkts = a->reordered = 0;
+}
+
+static inline void arrival_close_burst(struct arrival *a, uint64_t bin_ns)
+{
+	if (a->burst_bins == 0)
+		return;
+	hist_add(&a->burst, a->burst_bins * bin_ns);
+	if (a->burst_pkts > a->peak_burst_pkts)
+		a->peak_burst_pkts = a->burst_pkts;
+	a->burst_bins = a->burst_pkts = 0;
+}
+
+/**
+ * the open bin is done: it extends the burst if it is well above the mean
+ * rate since the first arrival, and ends it otherwise
+ */
+static inline void arrival_close_bin(struct arrival *a, uint64_t bin_ticks, uint64_t bin_ns)
+{
+	uint64_t bins = a->bin - a->first / bin_ticks + 1;
+
+	if (a->bin_pkts == 0)
+		return;
+	if (a->bin_pkts > 1 && (uint64_t)a->bin_pkts * bins > BURST_FACTOR * a->binned) {
+		a->burst_bins++;
+		a->burst_pkts += a->bin_pkts;
+	} else {
+		arrival_close_burst(a, bin_ns);
+	}
+	a->bin_pkts = 0;
+}
+
+static inline void arrival_add(struct arrival *a, uint64_t now, uint32_t len, uint64_t bin_ticks, uint64_t bin_ns)
+{
+	uint64_t bin = now / bin_ticks;
+
+	if (a->last != 0)
+		hist_add(&a->gap, tick_to_ns(now - a->last));
+	else
+		a->first = now;
+	hist_add(&a->size, len);
+	a->last = now;
+
+	// sliding peak: drop what fell out of the window, then add this one
+	while (a->win_pkts > 0 && (a->win_pkts == ARRIVAL_WINDOW ||
+		a->win[a->win_head].tick + bin_ticks <= now)) {
+		if (a->win_pkts == ARRIVAL_WINDOW && a->win[a->win_head].tick + bin_ticks > now)
+			a->peak_capped = true;
+		a->win_bytes -= a->win[a->win_head].len;
+		a->win_head = (a->win_head + 1) % ARRIVAL_WINDOW;
+		a->win_pkts--;
+	}
+	uint32_t k = (a->win_head + a->win_pkts) % ARRIVAL_WINDOW;
+	a->win[k].tick = now;
+	a->win[k].len = len;
+	a->win_pkts++;
+	a->win_bytes += len;
+	if (a->win_pkts > a->peak_pkts)
+		a->peak_pkts = a->win_pkts;
+	if (a->win_bytes > a->peak_bytes)
+		a->peak_bytes = a->win_bytes;
+
+	if (bin != a->bin) {
+		arrival_close_bin(a, bin_ticks, bin_ns);
+		// empty bins in between are below any mean
+		if (bin != a->bin + 1)
+			arrival_close_burst(a, bin_ns);
+		a->bin = bin;
+	}
+
+	a->bin_pkts++;
+	a->binned++;
+}
+
+/**
+ * packet ids from a single sender: whatever never arrived below the
+ * highest id is lost, an id below it arrives out of order
+ */
+static inline void arrival_seq(struct arrival *a, uint32_t id)
+{
+	a->pkts++;
+	if (id >= a->next_id)
+		a->next_id = id + 1;
+	else
+		a->reordered++;
+}
+
+static inline uint64_t arrival_lost(struct arrival *a)
+{
+	return a->next_id > a->pkts ? a->next_id - a->pkts : 0;
+}
+
+static void arrival_print(FILE *out, struct arrival *a, uint64_t bin_ticks, uint64_t bin_ns)
+{
+	// the open bin and burst count too
+	arrival_close_bin(a, bin_ticks, bin_ns);
+	arrival_close_burst(a, bin_ns);
+
+	hist_print(out, "inter-arrival", &a->gap);
+	hist_print_unit(out, "size", &a->size, 1.0, "B");
+	hist_print(out, "burst length", &a->burst);
+	if (a->delay.count > 0)
+		hist_print(out, "one-way delay", &a->delay);
+	if (a->delay_negative > 0)
+		fprintf(out, ">   %-14s %" PRIu64 " samples negative (receiver clock behind the sender)\n",
+			"", a->delay_negative);
+	fprintf(out, ">   %-14s %s%u pkts / %u B in %.0f us, %.0f pps / %.1f Mbit/s peak, largest burst %u pkts\n",
+		"microburst", a->peak_capped ? ">= " : "", a->peak_pkts, a->peak_bytes, bin_ns / 1000.0,
+		a->peak_pkts * 1e9 / bin_ns, a->peak_bytes * 8e3 / bin_ns, a->peak_burst_pkts);
+	fprintf(out, ">   %-14s %" PRIu64 " lost (%.3f%%), %" PRIu64 " reordered\n", "sequence",
+		arrival_lost(a), a->next_id ? 100.0 * arrival_lost(a) / a->next_id : 0.0, a->reordered);
+}
+
+/**
+ * end of a udp test. the client sends "END <packets> <stop_ns> <owd_ns>"
+ * a few times once it stopped: stop_ns on the server clock and owd_ns,
+ * half the best sync rtt, if the clocks were synced (owd_ns -1 if not).
+ * the server keeps counting until every client sent it, plus DRAIN_NS for
+ * stragglers, but never longer than DRAIN_MAX_NS past its own deadline.
+ * the latest arrivals are kept by packet id so the ones that were still
+ * in the network at stop time can be picked out later. without synced
+ * clocks there is no stop time on the server clock, only the count.
+ */
+#define DRAIN_RING   (4096)
+#define DRAIN_NS     (50 * 1000 * 1000)
+#define DRAIN_MAX_NS (2000 * 1000 * 1000)
+#define END_REPEAT   (3)
+
+struct drain
+{
+	bool        ended;
+	bool        synced;
+	uint32_t    count;        /* packets the client sent */
+	uint64_t    stop;         /* tick */
+	uint64_t    owd_ns;       /* base one-way delay */
+	struct {
+		uint64_t tick;
+		uint32_t id;
+		uint32_t len;
+	} ring[DRAIN_RING];
+};
+
+struct drain_report
+{
+	uint64_t    drain_ns;     /* stop to the last arrival */
+	uint32_t    inflight;     /* packets that arrived after stop */
+	uint64_t    bytes;
+	uint64_t    queue_ns;     /* drain beyond the base one-way delay */
+	bool        saturated;    /* the whole ring arrived after stop */
+};
+
+static inline void drain_add(struct drain *d, uint32_t id, uint64_t now, uint32_t len)
+{
+	d->ring[id % DRAIN_RING].tick = now;
+	d->ring[id % DRAIN_RING].id = id;
+	d->ring[id % DRAIN_RING].len = len;
+}
+
+/**
+ * END from a client, true the first time. the count reveals a lost tail
+ * that packet ids alone cannot show.
+ */
+static bool drain_end(struct drain *d, struct arrival *a, const char *msg)
+{
+	struct tick_base base;
+	unsigned int count;
+	long long stop_ns, owd_ns;
+
+	if (d->ended || sscanf(msg, "END %u %lld %lld", &count, &stop_ns, &owd_ns) != 3)
+		return false;
+
+	d->ended = true;
+	d->synced = owd_ns >= 0;
+	d->owd_ns = owd_ns >= 0 ? (uint64_t)owd_ns : 0;
+	d->count = count;
+	if (d->synced) {
+		// a fresh pairing, the stop is only milliseconds ago
+		tick_rebase(&base);
+		d->stop = tick_from_wall_ns(&base, stop_ns);
+	}
+	if (count > a->next_id)
+		a->next_id = count;
+	return true;
+}
+
+/**
+ * what was queued on the path when the client stopped: the packets that
+ * arrived afterwards, and how much longer than the bare path they took
+ */
+static void drain_summary(struct drain *d, struct drain_report *r)
+{
+	uint64_t last = d->stop;
+	uint32_t lo = d->count > DRAIN_RING ? d->count - DRAIN_RING : 0;
+
+	memset(r, 0, sizeof *r);
+	for (uint32_t id = lo; id < d->count; ++id) {
+		uint32_t k = id % DRAIN_RING;
+		if (d->ring[k].tick == 0 || d->ring[k].id != id || d->ring[k].tick <= d->stop)
+			continue;
+		r->inflight++;
+		r->bytes += d->ring[k].len;
+		if (d->ring[k].tick > last)
+			last = d->ring[k].tick;
+	}
+
+	r->drain_ns = tick_to_ns(last - d->stop);
+	r->saturated = d->count > DRAIN_RING && r->inflight == DRAIN_RING;
+	r->queue_ns = r->drain_ns > d->owd_ns ? r->drain_ns - d->owd_ns : 0;
+}
+
+static void drain_print(FILE *out, struct drain *d, struct drain_report *r)
+{
+	if (!d->ended) {
+		fprintf(out, ">   %-14s no END from the client, counted until the drain limit\n", "drain");
+		return;
+	}
+
+	if (!d->synced) {
+		fprintf(out, ">   %-14s not measured, the clocks were not synced\n", "drain");
+		return;
+	}
+
+	fprintf(out, ">   %-14s %.3f ms after stop, %s%u pkts / %" PRIu64 " B in flight at stop\n", "drain",
+		r->drain_ns / 1e6, r->saturated ? ">= " : "", r->inflight, r->bytes);
+	fprintf(out, ">   %-14s %" PRIu64 " B, %.3f ms beyond a %.3f ms one-way path\n", "standing queue",
+		r->bytes, r->queue_ns / 1e6, d->owd_ns / 1e6);
+}
+
+/**
+ * result store: every test appends one line per role (and per client on
+ * the server) to the file given with --store,
+ *
+ *   label=A role=server env.host=... cfg.time=10 ... rx_pkts=9421 ...
+ *
+ * keys with a dot are metadata (environment, config, histogram buckets),
+ * the others are numeric metrics that jana-compare aggregates by label.
+ */
+static FILE *store_begin(struct jana_config *cfg, const char *role)
+{
+	char ip[INET_ADDRSTRLEN];
+	struct utsname un;
+	FILE *fp = fopen(cfg->store, "a");
+
+	if (fp == NULL) {
+		log_perror(cfg->log, "store_begin: failed to open result store");
+		return NULL;
+	}
+
+	uname(&un);
+	inet_ntop(AF_INET, &(cfg->addr.sin_addr), ip, INET_ADDRSTRLEN);
+	fprintf(fp, "label=%s role=%s env.time=%ld env.host=%s env.kernel=%s env.arch=%s env.tick=%s",
+		cfg->label, role, (long)time(NULL), un.nodename, un.release, un.machine,
+		TICK_SOURCE_NAME[ticks.source]);
+	fprintf(fp, " cfg.addr=%s:%u cfg.time=%d cfg.proto=%s", ip, ntohs(cfg->addr.sin_port),
+		cfg->testtime, cfg->tcp ? "tcp" : cfg->raw_if == NULL ? "udp" : cfg->raw_xdp ? "xdp" : "raw");
+	if (cfg->wait_arg[0] != NULL)
+		fprintf(fp, " cfg.rate=%s:%s", cfg->wait_arg[0], cfg->wait_arg[1]);
+	if (cfg->data_arg[0] != NULL)
+		fprintf(fp, " cfg.data=%s:%s", cfg->data_arg[0], cfg->data_arg[1]);
+	if (cfg->scenario != NULL)
+		fprintf(fp, " cfg.scenario=%s", cfg->scenario);
+	if (cfg->replay != NULL)
+		fprintf(fp, " cfg.replay=%s cfg.speed=%g cfg.pps=%g", cfg->replay, cfg->replay_speed, cfg->replay_pps);
+	if (cfg->rt)
+		fprintf(fp, " cfg.rt=%d,%d", cfg->rt_cpu, cfg->rt_prio);
+	if (cfg->verify)
+		fprintf(fp, " cfg.verify=%u", cfg->verify_seed);
+	return fp;
+}
+
+/**
+ * mean and percentiles of a histogram as metrics `key_p50` etc, scaled
+ * by `div`, plus its non-empty buckets as `hist.key=idx:count,...`
+ */
+static void store_hist(FILE *fp, const char *key, struct jana_hist *h, double div)
+{
+	if (h->count == 0)
+		return;
+
+	fprintf(fp, " %s_mean=%.3f %s_p50=%.3f %s_p90=%.3f %s_p99=%.3f %s_max=%.3f",
+		key, (double)h->sum / h->count / div,
+		key, jana_hist_quantile(h, 0.50) / div, key, jana_hist_quantile(h, 0.90) / div,
+		key, jana_hist_quantile(h, 0.99) / div, key, h->max / div);
+
+	char sep = '=';
+	fprintf(fp, " hist.%s", key);
+	for (uint32_t i = 0; i < HIST_BUCKETS; ++i) {
+		if (h->bucket[i] == 0)
+			continue;
+		fprintf(fp, "%c%u:%" PRIu64, sep, i, h->bucket[i]);
+		sep = ',';
+	}
+}
+
+static void store_end(FILE *fp)
+{
+	fputc('\n', fp);
+	fclose(fp);
+}
+
+/**
+ * crc32c (castagnoli) with the hardware instruction where there is one:
+ * SSE4.2 on x86, the ARMv8 CRC extension on aarch64, slicing-by-8 tables
+ * everywhere else. the variant is picked once by crc32c_init(), which
+ * also checks the table against the known answer and the instruction
+ * against the table; a failed check makes --verify refuse to run.
+ */
+typedef uint32_t (*crc32c_fn)(uint32_t crc, const uint8_t *buf, size_t len);
+
+static uint32_t crc32c_table[8][256];
+
+static uint32_t crc32c_sw(uint32_t crc, const uint8_t *buf, size_t len)
+{
+	crc = ~crc;
+
+	while (len >= 8) {
+		uint32_t lo, hi;
+		memcpy(&lo, buf, 4);
+		memcpy(&hi, buf + 4, 4);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		lo = __builtin_bswap32(lo);
+		hi = __builtin_bswap32(hi);
+#endif
+		lo ^= crc;
+		crc = crc32c_table[7][lo & 0xff] ^ crc32c_table[6][(lo >> 8) & 0xff] ^
+			crc32c_table[5][(lo >> 16) & 0xff] ^ crc32c_table[4][lo >> 24] ^
+			crc32c_table[3][hi & 0xff] ^ crc32c_table[2][(hi >> 8) & 0xff] ^
+			crc32c_table[1][(hi >> 16) & 0xff] ^ crc32c_table[0][hi >> 24];
+		buf += 8;
+		len -= 8;
+	}
+
+	while (len--)
+		crc = crc32c_table[0][(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const uint8_t *buf, size_t len)
+{
+	crc = ~crc;
+#if defined(__x86_64__)
+	uint64_t c = crc;
+	while (len >= 8) {
+		uint64_t v;
+		memcpy(&v, buf, 8);
+		c = _mm_crc32_u64(c, v);
+		buf += 8;
+		len -= 8;
+	}
+	crc = (uint32_t)c;
+#endif
+	while (len >= 4) {
+		uint32_t v;
+		memcpy(&v, buf, 4);
+		crc = _mm_crc32_u32(crc, v);
+		buf += 4;
+		len -= 4;
+	}
+	while (len--)
+		crc = _mm_crc32_u8(crc, *buf++);
+	return ~crc;
+}
+#elif defined(__aarch64__)
+__attribute__((target("+crc")))
+static uint32_t crc32c_hw(uint32_t crc, const uint8_t *buf, size_t len)
+{
+	crc = ~crc;
+	while (len >= 8) {
+		uint64_t v;
+		memcpy(&v, buf, 8);
+		crc = __crc32cd(crc, v);
+		buf += 8;
+		len -= 8;
+	}
+	while (len--)
+		crc = __crc32cb(crc, *buf++);
+	return ~crc;
+}
+#endif
+
+static crc32c_fn crc32c = crc32c_sw;
+static const char *crc32c_name = "table";
+static bool crc32c_ok;
+
+static void crc32c_init(void)
+{
+	for (uint32_t i = 0; i < 256; ++i) {
+		uint32_t c = i;
+		for (int k = 0; k < 8; ++k)
+			c = c & 1 ? (c >> 1) ^ 0x82f63b78 : c >> 1;
+		crc32c_table[0][i] = c;
+	}
+	for (uint32_t i = 0; i < 256; ++i)
+		for (int t = 1; t < 8; ++t)
+			crc32c_table[t][i] = (crc32c_table[t-1][i] >> 8) ^ crc32c_table[0][crc32c_table[t-1][i] & 0xff];
+
+#if defined(__x86_64__) || defined(__i386__)
+	if (__builtin_cpu_supports("sse4.2")) {
+		crc32c = crc32c_hw;
+		crc32c_name = "sse4.2";
+	}
+#elif defined(__aarch64__)
+	if (getauxval(AT_HWCAP) & HWCAP_CRC32) {
+		crc32c = crc32c_hw;
+		crc32c_name = "armv8 crc";
+	}
+#endif
+
+	crc32c_ok = crc32c_sw(0, (const uint8_t*)"123456789", 9) == 0xe3069283;
+
+	// every tail length and alignment the hardware loops take apart
+	if (crc32c != crc32c_sw) {
+		uint8_t buf[80];
+		for (uint32_t i = 0; i < sizeof buf; ++i)
+			buf[i] = (uint8_t)(i * 167 + 13);
+		for (uint32_t off = 0; off < 8 && crc32c_ok; ++off)
+			for (uint32_t len = 0; off + len <= sizeof buf && crc32c_ok; ++len)
+				crc32c_ok = crc32c(off, buf + off, len) == crc32c_sw(off, buf + off, len);
+	}
+}
+
+/**
+ * verified payloads: packet id, intended length, a pattern drawn from the
+ * id and the seed, and a crc32c trailer seeded with the seed. a packet of
+ * another sender (other seed) fails the crc like a corrupted one.
+ *
+ *   | id (4) | len (4) | pattern ... | crc32c (4) |
+ */
+#define PAYLOAD_MIN_VERIFY (12)
+
+static inline void payload_seal(uint8_t *buf, uint32_t packet_id, uint32_t len, uint32_t seed)
+{
+	uint32_t x = ((packet_id ^ seed) * 0x9e3779b9) | 1;
+	uint32_t v = htonl(len);
+	uint32_t end = len - sizeof(uint32_t);
+	uint32_t i = 8;
+
+	memcpy(buf + 4, &v, 4);
+	for (; i + 4 <= end; i += 4) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		memcpy(buf + i, &x, 4);
+	}
+	for (; i < end; ++i)
+		buf[i] = (uint8_t)(x >> (8 * (i & 3)));
+
+	v = htonl(crc32c(seed, buf, end));
+	memcpy(buf + end, &v, 4);
+}
+
+enum payload_status { payload_ok, payload_corrupt, payload_truncated };
+
+static inline enum payload_status payload_check(const uint8_t *buf, uint32_t len, uint32_t seed)
+{
+	uint32_t want, crc;
+
+	if (len < PAYLOAD_MIN_VERIFY)
+		return payload_truncated;
+
+	memcpy(&want, buf + 4, 4);
+	want = ntohl(want);
+	if (want > len)
+		return payload_truncated;
+	if (want != len)
+		return payload_corrupt;
+
+	memcpy(&crc, buf + len - 4, 4);
+	return ntohl(crc) == crc32c(seed, buf, len - 4) ? payload_ok : payload_corrupt;
+}
+
+/**
+ * multicast payloads carry their send time, CLOCK_REALTIME of the client,
+ * so every receiver can tell its own one-way delay
+ *
+ *   | id (4) | send ns (8) | ...
+ */
+#define PAYLOAD_MIN_STAMP (12)
+
+static inline void payload_stamp(uint8_t *buf, int64_t ns)
+{
+	uint32_t v[2] = { htonl((uint32_t)((uint64_t)ns >> 32)), htonl((uint32_t)ns) };
+	memcpy(buf + 4, v, 8);
+}
+
+static inline int64_t payload_stamp_read(const uint8_t *buf)
+{
+	uint32_t v[2];
+	memcpy(v, buf + 4, 8);
+	return (int64_t)(((uint64_t)ntohl(v[0]) << 32) | ntohl(v[1]));
+}
+
+struct integrity
+{
+	uint64_t ok;
+	uint64_t corrupt;
+	uint64_t truncated;
+};
+
+/**
+ * poor man's socket wrapper
+ */
+static int init_socket(struct sockaddr_in *addr, bool nonblock, FILE *log)
+{
+	int sockfd;
+
+	sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+	if (sockfd <= 0) {
+		log_perror(log, "init_socket: failed to create socket");
+		return -1;
+	}
+
+	if (bind(sockfd, (const struct sockaddr*)addr, sizeof(struct sockaddr_in)) < 0) {
+		log_perror(log, "init_socket: failed to bind socket");
+		close(sockfd);
+		return -1;
+	}
+
+	if (nonblock) {
+		fcntl(sockfd, F_SETFL, O_NONBLOCK);
+	}
+
+	return sockfd;
+}
+
+/**
+ * multicast receiver: joins the group on the interface with address
+ * join_if. the port is shared, so several receivers can run on one host
+ * and each gets its own copy of the stream.
+ */
+static int init_mcast_socket(struct jana_config *cfg)
+{
+	struct ip_mreq mreq;
+	int one = 1;
+	int sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+	if (sockfd < 0) {
+		log_perror(cfg->log, "init_mcast_socket: failed to create socket");
+		return -1;
+	}
+
+	mreq.imr_multiaddr = cfg->join_group;
+	mreq.imr_interface = cfg->join_if;
+
+	if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one) < 0 ||
+		setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof one) < 0) {
+		log_perror(cfg->log, "init_mcast_socket: SO_REUSEADDR/SO_REUSEPORT");
+		close(sockfd);
+		return -1;
+	}
+
+	if (bind(sockfd, (const struct sockaddr*)&cfg->addr, sizeof(struct sockaddr_in)) < 0) {
+		log_perror(cfg->log, "init_mcast_socket: failed to bind socket");
+		close(sockfd);
+		return -1;
+	}
+
+	if (setsockopt(sockfd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof mreq) < 0) {
+		log_perror(cfg->log, "init_mcast_socket: IP_ADD_MEMBERSHIP");
+		close(sockfd);
+		return -1;
+	}
+
+	fcntl(sockfd, F_SETFL, O_NONBLOCK);
+	return sockfd;
+}
+
+static bool mcast_sender(int sockfd, struct jana_config *cfg)
+{
+	int ttl = cfg->mcast_ttl;
+
+	if (setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof ttl) < 0 ||
+		setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_IF, &cfg->mcast_if, sizeof cfg->mcast_if) < 0) {
+		log_perror(cfg->log, "mcast_sender: IP_MULTICAST_TTL/IP_MULTICAST_IF");
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * receivers of a multicast client. they may share an address, so they
+ * are told apart by the id in their "HELLO <id>" and "READY <id>".
+ */
+struct receivers
+{
+	uint32_t hello[MAX_CLIENTS];
+	uint32_t ready[MAX_CLIENTS];
+	uint32_t n_hello;
+	uint32_t n_ready;
+};
+
+static void receivers_add(uint32_t *ids, uint32_t *n, uint32_t id)
+{
+	for (uint32_t i = 0; i < *n; ++i)
+		if (ids[i] == id)
+			return;
+	if (*n < MAX_CLIENTS)
+		ids[(*n)++] = id;
+}
+
+/**
+ * drain the control socket, true once `want` receivers said HELLO (or
+ * READY with `ready`)
+ */
+static bool receivers_poll(int sockfd, struct receivers *r, uint32_t want, bool ready)
+{
+	char msg[100];
+	unsigned int id;
+	int len;
+
+	while ((len = recvfrom(sockfd, msg, sizeof msg - 1, 0, NULL, NULL)) > 0) {
+		msg[len] = '\0';
+		if (sscanf(msg, "HELLO %u", &id) == 1)
+			receivers_add(r->hello, &r->n_hello, id);
+		else if (sscanf(msg, "READY %u", &id) == 1)
+			receivers_add(r->ready, &r->n_ready, id);
+	}
+
+	return (ready ? r->n_ready : r->n_hello) >= want;
+}
+
+/**
+ * answer a "SYNC? t1" clock probe with "SYNC! t1 t2 t3"
+ */
+static bool answer_sync(int sockfd, const char *msg, int64_t t2, struct sockaddr_in *from)
+{
+	char reply[100];
+	long long t1;
+
+	if (strncmp(msg, "SYNC? ", 6) != 0 || sscanf(msg + 6, "%lld", &t1) != 1)
+		return false;
+
+	int len = snprintf(reply, sizeof reply, "SYNC! %lld %lld %lld", t1,
+		(long long)t2, (long long)clock_now_ns(CLOCK_REALTIME));
+	sendto(sockfd, reply, len+1, 0, (struct sockaddr*)from, sizeof(struct sockaddr_in));
+	return true;
+}
+
+static bool read_message(int sockfd, const char *want, struct sockaddr_in *from)
+{
+	char storage[100];
+	struct sockaddr addr;
+	socklen_t fromlen = sizeof addr;
+
+	int len = recvfrom(sockfd, storage, sizeof storage - 1, 0, &addr, &fromlen);
+
+	if (len <= 0) {
+		return false;
+	}
+
+	storage[len] = '\0';
+
+	if (answer_sync(sockfd, storage, clock_now_ns(CLOCK_REALTIME), (struct sockaddr_in*)&addr))
+		return false;
+
+	if (from != 0)
+		*from = *((struct sockaddr_in*)&addr);
+
+	return strcmp(storage, want) == 0;
+}
+
+/**
+ * run up to `probes` clock probes against the server and keep the one
+ * with the lowest rtt. replies to earlier, timed out probes are still
+ * accepted since each one carries its own t1. a READY that arrives in
+ * the meantime is reported through `ready` instead of being lost.
+ */
+static bool clock_sync(int sockfd, struct sockaddr_in *peer, uint32_t probes,
+	struct clock_sync *out, bool *ready)
+{
+	char msg[100];
+
+	memset(out, 0, sizeof *out);
+
+	for (uint32_t sent = 0; sent < 4 * probes && out->probes < probes; ++sent) {
+		int64_t t1 = clock_now_ns(CLOCK_REALTIME);
+		int len = snprintf(msg, sizeof msg, "SYNC? %lld", (long long)t1);
+		sendto(sockfd, msg, len+1, 0, (struct sockaddr*)peer, sizeof(struct sockaddr_in));
+
+		struct pollfd pfd = { .fd = sockfd, .events = POLLIN };
+		while (poll(&pfd, 1, 100) > 0) {
+			len = recvfrom(sockfd, msg, sizeof msg - 1, 0, NULL, NULL);
+			int64_t t4 = clock_now_ns(CLOCK_REALTIME);
+			if (len <= 0)
+				break;
+			msg[len] = '\0';
+
+			long long r1, r2, r3;
+			if (sscanf(msg, "SYNC! %lld %lld %lld", &r1, &r2, &r3) != 3) {
+				if (ready != NULL && strcmp(msg, "READY") == 0)
+					*ready = true;
+				continue;
+			}
+
+			int64_t rtt = (t4 - r1) - (r3 - r2);
+			if (rtt < 0)
+				rtt = 0;
+
+			if (out->probes++ == 0 || rtt < out->rtt_ns) {
+				out->valid     = true;
+				out->rtt_ns    = rtt;
+				out->error_ns  = rtt / 2;
+				out->offset_ns = ((r2 - r1) + (r3 - t4)) / 2;
+				out->ref_ns    = r1 + (t4 - r1) / 2;
+			}
+
+			if (r1 == t1)
+				break;
+		}
+	}
+
+	return out->valid;
+}
+
+static void clock_model_fit(struct clock_model *m, struct clock_sync *before, struct clock_sync *after)
+{
+	memset(m, 0, sizeof *m);
+
+	if (!before->valid)
+		return;
+
+	m->valid     = true;
+	m->offset_ns = before->offset_ns;
+	m->error_ns  = before->error_ns;
+	m->ref_ns    = before->ref_ns;
+
+	if (after->valid && after->ref_ns > before->ref_ns) {
+		double dt = (double)(after->ref_ns - before->ref_ns);
+		m->drift = (double)(after->offset_ns - before->offset_ns) / dt;
+		m->drift_error = (double)(after->error_ns + before->error_ns) / dt;
+	}
+}
+
+/**
+ * map a client CLOCK_REALTIME timestamp [us] onto the server's clock
+ */
+static uint64_t clock_model_apply_us(struct clock_model *m, uint64_t t_us)
+{
+	if (!m->valid)
+		return t_us;
+
+	double dt = (double)((int64_t)t_us * 1000 - m->ref_ns);
+	int64_t ns = (int64_t)t_us * 1000 + m->offset_ns + (int64_t)(m->drift * dt);
+	return (uint64_t)(ns / 1000);
+}
+
+static bool cmpaddr(struct sockaddr_in *a, struct sockaddr_in *b)
+{
+	return a->sin_addr.s_addr == b->sin_addr.s_addr;
+}
+
+/**
+ * write packets first..first+n of the per-packet client log, send times
+ * mapped onto the server clock. the header goes with packet 0.
+ */
+static void write_log(FILE *logfd, uint32_t first, uint32_t n, uint64_t *ttime, uint64_t *delay,
+	const struct tick_base *base, struct clock_model *clock)
+{
+	if (first == 0)
+		fprintf(logfd, "packet,time,sendto_us\n");
+	for (uint64_t i = 0; i < n; i++) {
+		fprintf(logfd, "%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n", first + i,
+			clock_model_apply_us(clock, tick_to_wall_us(base, ttime[i])),
+			tick_to_ns(delay[i]) / 1000);
+	}
+}
+
+/**
+ * send ticks of a client test. the arrays hold a window of `cap` packets;
+ * a replay, whose length is the schedule's, spills every full window to
+ * an unlinked temporary file with one fwrite per array, so memory stays
+ * at the window however long the trace. the other modes get a window of
+ * MAX_PACKETS and never spill.
+ */
+#define LOG_WINDOW (65536)
+
+struct packet_log
+{
+	uint64_t *ttime;
+	uint64_t *delay;
+	uint32_t  cap;
+	uint32_t  base;           /* packet id of ttime[0] */
+	FILE     *spill;          /* earlier windows, NULL while all fits */
+};
+
+static bool packet_log_spill(struct packet_log *l, uint32_t n)
+{
+	if (l->spill == NULL && (l->spill = tmpfile()) == NULL)
+		return false;
+	if (fwrite(l->ttime, sizeof(uint64_t), n, l->spill) != n ||
+		fwrite(l->delay, sizeof(uint64_t), n, l->spill) != n)
+		return false;
+	l->base += n;
+	return true;
+}
+
+/**
+ * load the window starting at packet `id` of `total` into the arrays,
+ * returns its length, 0 past the end. without a spill the arrays hold
+ * everything already.
+ */
+static uint32_t packet_log_window(struct packet_log *l, uint32_t id, uint32_t total)
+{
+	uint32_t n = total - id < l->cap ? total - id : l->cap;
+
+	if (l->spill == NULL)
+		return id == 0 ? n : 0;
+	if (n == 0 || fseeko(l->spill, (off_t)id * 2 * sizeof(uint64_t), SEEK_SET) < 0 ||
+		fread(l->ttime, sizeof(uint64_t), n, l->spill) != n ||
+		fread(l->delay, sizeof(uint64_t), n, l->spill) != n)
+		return 0;
+	return n;
+}
+
+/**
+ * due tick of the next -r departure: the drawn gap after the previous
+ * due time, so sleep overshoot does not add up, but never more than one
+ * gap before the previous send returned, so a stall is not made up with
+ * a burst of everything owed
+ */
+static inline double pace_due(double due, uint64_t prev_end, uint32_t wait_us)
+{
+	double gap = wait_us * 1000.0 / ticks.ns_per_tick;
+
+	if (due < (double)prev_end - gap)
+		due = (double)prev_end - gap;
+	return due + gap;
+}
+
+/**
+ * tool overhead of a finished client test, rebuilt from the per-packet
+ * send ticks so the send loop itself carries no extra bookkeeping.
+ * pacing error is the actual departure minus its due time, replayed
+ * with pace_due() from the same ticks the loop saw. departures before
+ * their due time are counted apart. the packet log is fed in windows.
+ */
+struct client_hists
+{
+	struct jana_hist syscall, outside, pacing;
+	uint64_t    early;       /* departures before their due time */
+	uint64_t    in_send;     /* ns */
+	uint64_t    span;        /* ns, first send to last return */
+	double      due;
+	uint64_t    first;       /* tick of the first send */
+	uint64_t    prev_end;    /* tick the previous send returned */
+	uint32_t    n;
+};
+
+static void client_hists_begin(struct client_hists *ch, double start)
+{
+	hist_reset(&ch->syscall);
+	hist_reset(&ch->outside);
+	hist_reset(&ch->pacing);
+	ch->early = 0;
+	ch->in_send = 0;
+	ch->span = 0;
+	ch->due = start;
+	ch->prev_end = (uint64_t)start;
+	ch->n = 0;
+}
+
+static void client_hists_add(struct jana_config *cfg, struct client_hists *ch, uint32_t n,
+	uint64_t *ttime, uint64_t *delay, uint32_t *wait)
+{
+	for (uint32_t i = 0; i < n; ++i) {
+		uint64_t d = tick_to_ns(delay[i]);
+		hist_add(&ch->syscall, d);
+		ch->in_send += d;
+
+		if (cfg->wait_rv && wait != NULL) {
+			ch->due = pace_due(ch->due, ch->prev_end, wait[ch->n]);
+			if (ttime[i] >= (uint64_t)ch->due)
+				hist_add(&ch->pacing, tick_to_ns(ttime[i] - (uint64_t)ch->due));
+			else
+				ch->early++;
+		}
+
+		if (ch->n > 0)
+			hist_add(&ch->outside, tick_to_ns(ttime[i] - ch->prev_end));
+		else
+			ch->first = ttime[i];
+		ch->prev_end = ttime[i] + delay[i];
+		ch->n++;
+	}
+
+	ch->span = ch->n > 0 ? tick_to_ns(ch->prev_end - ch->first) : 0;
+}
+
+static void client_overhead(struct jana_config *cfg, struct client_hists *ch)
+{
+	FILE *out = cfg->out;
+
+
+	fprintf(cfg->out, "> tool overhead: %.1f%% of the test spent in sendto\n",
+		ch->span ? 100.0 * ch->in_send / ch->span : 0.0);
+	hist_print(out, "sendto", &ch->syscall);
+	hist_print(out, "outside send", &ch->outside);
+	if (cfg->wait_rv) {
+		hist_print(out, "pacing error", &ch->pacing);
+		fprintf(out, ">   %-14s %" PRIu64 " departures before their due time\n", "early", ch->early);
+	}
+}
+
+/**
+ * throughput of the pieces of jana that run outside the network: random
+ * variate generation and log writing. one "> bench" line per measurement.
+ */
+void jana_print_microbench(FILE *out)
+{
+	enum { N = 1000000 };
+	static const char *PDF_NAME[] = { "uniform", "exp", "weibull" };
+	pdf_rv_fn pdf_fn[] = { uniform_rvs, exp_rvs, weibull_rvs };
+	pdf_cfg_t pdf_cfg[3];
+	volatile uint32_t sink = 0;
+	unsigned int seed = 1;
+
+	jana_init();
+
+	pdf_cfg[0].uniform.n = 100; pdf_cfg[0].uniform.k = 10;
+	pdf_cfg[1].exp.n = 100;
+	pdf_cfg[2].weibull.a = 3; pdf_cfg[2].weibull.b = 0.5;
+
+	for (int d = 0; d < 3; ++d) {
+		uint64_t t0 = tick_now();
+		for (int i = 0; i < N; ++i)
+			sink += (uint32_t)pdf_fn[d](&pdf_cfg[d], &seed);
+		uint64_t t1 = tick_now();
+		fprintf(out, "> bench rng_%s %.3f Mrv/s\n", PDF_NAME[d], N * 1000.0 / tick_to_ns(t1 - t0));
+	}
+
+	{
+		uint64_t *ttime = calloc(N, sizeof(uint64_t));
+		uint64_t *delay = calloc(N, sizeof(uint64_t));
+		struct clock_model clock;
+		struct tick_base base;
+		char path[] = "/tmp/jana-bench-XXXXXX";
+		int fd = mkstemp(path);
+		FILE *logfd = fd < 0 ? NULL : fdopen(fd, "w");
+
+		if (ttime == NULL || delay == NULL || logfd == NULL) {
+			log_perror(out, "microbench: log setup");
+			if (logfd != NULL)
+				fclose(logfd);
+			free(ttime);
+			free(delay);
+			return;
+		}
+
+		memset(&clock, 0, sizeof clock);
+		tick_rebase(&base);
+		for (uint32_t i = 0; i < N; ++i) {
+			ttime[i] = tick_now();
+			delay[i] = i % 100;
+		}
+
+		uint64_t t0 = tick_now();
+		write_log(logfd, 0, N, ttime, delay, &base, &clock);
+		fflush(logfd);
+		uint64_t t1 = tick_now();
+		long bytes = ftell(logfd);
+
+		fprintf(out, "> bench log_rows %.3f Mrows/s\n", N * 1000.0 / tick_to_ns(t1 - t0));
+		fprintf(out, "> bench log_bytes %.3f MB/s\n", bytes * 1000.0 / tick_to_ns(t1 - t0));
+
+		fclose(logfd);
+		unlink(path);
+		free(ttime);
+		free(delay);
+	}
+
+	(void)sink;
+}
+
+static const char * SPINNER[] = { "/", "-", "\\", "|" };
+
+/**
+ * tcp mode: the stream is cut into messages, each starting with this
+ * header in network byte order. `len` counts the header, `send_ns` is the
+ * client's CLOCK_REALTIME at write, already mapped onto the server clock.
+ */
+struct msg_hdr
+{
+	uint32_t len;
+	uint32_t id;
+	uint32_t send_hi;
+	uint32_t send_lo;
+};
+
+/**
+ * TCP_INFO samples of one connection
+ */
+struct tcp_stats
+{
+	uint32_t samples;
+	uint32_t retrans;
+	uint32_t lost;
+	uint32_t cwnd_min, cwnd_max;
+	uint64_t cwnd_sum;
+	uint32_t rtt_min, rtt_max;      /* us */
+	uint64_t rtt_sum;
+	uint32_t stalls;                /* sends that ran into SO_SNDTIMEO */
+};
+
+static void tcp_stats_reset(struct tcp_stats *t)
+{
+	memset(t, 0, sizeof *t);
+	t->cwnd_min = UINT32_MAX;
+	t->rtt_min = UINT32_MAX;
+}
+
+static void tcp_sample(int fd, struct tcp_stats *t)
+{
+	struct tcp_info info;
+	socklen_t len = sizeof info;
+
+	if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) < 0)
+		return;
+
+	t->samples++;
+	t->retrans = info.tcpi_total_retrans;
+	t->lost = info.tcpi_lost;
+	t->cwnd_sum += info.tcpi_snd_cwnd;
+	t->rtt_sum += info.tcpi_rtt;
+	if (info.tcpi_snd_cwnd < t->cwnd_min) t->cwnd_min = info.tcpi_snd_cwnd;
+	if (info.tcpi_snd_cwnd > t->cwnd_max) t->cwnd_max = info.tcpi_snd_cwnd;
+	if (info.tcpi_rtt < t->rtt_min) t->rtt_min = info.tcpi_rtt;
+	if (info.tcpi_rtt > t->rtt_max) t->rtt_max = info.tcpi_rtt;
+}
+
+static void tcp_stats_print(FILE *out, struct tcp_stats *t)
+{
+	if (t->samples == 0) {
+		fprintf(out, ">   tcp_info       no samples\n");
+		return;
+	}
+
+	fprintf(out, ">   tcp_info       %u samples, %u retrans, %u lost, cwnd %u/%.1f/%u, rtt %u/%.1f/%u us (min/avg/max)\n",
+		t->samples, t->retrans, t->lost,
+		t->cwnd_min, (double)t->cwnd_sum / t->samples, t->cwnd_max,
+		t->rtt_min, (double)t->rtt_sum / t->samples, t->rtt_max);
+	if (t->stalls > 0)
+		fprintf(out, ">   %-14s %u sends blocked for a full send timeout\n", "stalls", t->stalls);
+}
+
+// interval between two TCP_INFO samples
+#define TCP_SAMPLE_NS (100 * 1000 * 1000)
+
+/**
+ * write a whole message, returns false once the connection is gone. a
+ * send timeout is a stalled receiver, not a lost one: it is counted and
+ * the send goes on, until the deadline has passed (errno EAGAIN then).
+ */
+static bool tcp_send_all(int fd, const uint8_t *buf, size_t len, uint64_t deadline, struct tcp_stats *t)
+{
+	while (len > 0) {
+		ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+		if (n <= 0) {
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+				t->stalls++;
+				if (tick_now() < deadline)
+					continue;
+			}
+			return false;
+		}
+		buf += n;
+		len -= n;
+	}
+	return true;
+}
+
+static int tcp_connect(struct sockaddr_in *addr, FILE *log)
+{
+	int one = 1;
+	struct timeval tv = { 1, 0 };
+	int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+	if (fd < 0) {
+		log_perror(log, "tcp_connect: failed to create socket");
+		return -1;
+	}
+
+	// messages go out as they are paced, and a stall is noticed within a second
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof tv);
+
+	if (connect(fd, (struct sockaddr*)addr, sizeof(struct sockaddr_in)) < 0) {
+		log_perror(log, "tcp_connect: failed to connect");
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static int tcp_listen(struct sockaddr_in *addr, FILE *log)
+{
+	int one = 1;
+	int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+	if (fd < 0) {
+		log_perror(log, "tcp_listen: failed to create socket");
+		return -1;
+	}
+
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+
+	if (bind(fd, (const struct sockaddr*)addr, sizeof(struct sockaddr_in)) < 0 ||
+		listen(fd, MAX_CLIENTS) < 0) {
+		log_perror(log, "tcp_listen: failed to listen");
+		close(fd);
+		return -1;
+	}
+
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+	return fd;
+}
+
+/**
+ * server side of one tcp connection; messages are reassembled in `buf`
+ */
+struct tcp_conn
+{
+	int                fd;
+	struct sockaddr_in peer;
+	uint32_t           have;
+	uint64_t           msgs;
+	uint64_t           bytes;
+	uint64_t           first_tick;
+	uint64_t           last_tick;
+	uint32_t           bad;
+	struct jana_hist   latency;
+	struct tcp_stats   info;
+	uint8_t            buf[2 * MAX_PKT_SIZE];
+};
+
+/**
+ * consume all complete messages in a connection's buffer
+ */
+static void tcp_conn_parse(struct tcp_conn *c, int64_t now_ns, uint32_t *counters, uint64_t *recvdata)
+{
+	uint32_t off = 0;
+	uint32_t f = chash(&c->peer);
+
+	while (c->have - off >= sizeof(struct msg_hdr)) {
+		struct msg_hdr *h = (struct msg_hdr*)(c->buf + off);
+		uint32_t len = ntohl(h->len);
+
+		if (len < sizeof(struct msg_hdr) || len > MAX_PKT_SIZE) {
+			// lost framing, nothing after this can be trusted
+			c->bad++;
+			off = c->have;
+			break;
+		}
+
+		if (c->have - off < len)
+			break;
+
+		int64_t sent = (int64_t)(((uint64_t)ntohl(h->send_hi) << 32) | ntohl(h->send_lo));
+		hist_add(&c->latency, now_ns > sent ? (uint64_t)(now_ns - sent) : 0);
+
+		c->msgs++;
+		c->bytes += len;
+		counters[f] = counters[f] + 1;
+		recvdata[f] = recvdata[f] + len;
+		off += len;
+	}
+
+	memmove(c->buf, c->buf + off, c->have - off);
+	c->have -= off;
+}
+
+/**
+ * raw packet backend: ethernet/ipv4/udp frames are built once in memory
+ * shared with the kernel (a PACKET_TX_RING, or an AF_XDP umem) and only
+ * the packet id, lengths and checksums are patched per packet. frames are
+ * handed to the kernel in batches. the udp source port is the one of the
+ * client's data socket, so the server and pcap2csv cannot tell the
+ * difference from the socket path.
+ */
+#define RAW_HDR_LEN   (14 + 20 + 8)
+#define RAW_FRAMES    (2048)
+#define XDP_FRAME_LEN (2048)
+
+struct xdp_ring
+{
+	uint32_t *producer;
+	uint32_t *consumer;
+	void     *desc;
+	uint32_t  mask;
+	uint32_t  cached;
+};
+
+struct raw_tx
+{
+	int       fd;
+	bool      xdp;
+	uint8_t  *map;
+	size_t    map_len;
+	uint32_t  frame_len;
+	uint32_t  head;
+	uint32_t  pending;
+	uint32_t  batch;
+	uint32_t  max_payload;
+	uint32_t  ip_sum;        /* header checksum partial sum without tot_len */
+	uint32_t  udp_sum;       /* pseudo header and ports partial sum */
+	uint8_t   frame[RAW_HDR_LEN];
+
+#ifdef JANA_XDP
+	struct xdp_ring tx;
+	struct xdp_ring cq;
+	struct xdp_ring fq;
+	uint8_t  *rings[3];
+	size_t    rings_len[3];
+	uint32_t  outstanding;
+#endif
+};
+
+static inline uint16_t csum_fold(uint32_t sum)
+{
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	return (uint16_t)~sum;
+}
+
+static uint32_t csum_add(uint32_t sum, const void *buf, size_t len)
+{
+	const uint8_t *p = buf;
+	for (size_t i = 0; i + 1 < len; i += 2)
+		sum += (p[i] << 8) | p[i+1];
+	if (len & 1)
+		sum += p[len-1] << 8;
+	return sum;
+}
+
+static bool parse_mac(const char *str, uint8_t *mac)
+{
+	return sscanf(str, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx",
+		mac, mac+1, mac+2, mac+3, mac+4, mac+5) == 6;
+}
+
+/**
+ * look up the neighbour entry of an on-link destination. the control
+ * handshake has talked to the server by then, so the entry exists.
+ */
+static bool arp_lookup(struct in_addr ip, const char *ifname, uint8_t *mac)
+{
+	char line[256], addr[64], hw[64], dev[IFNAMSIZ+1], want[INET_ADDRSTRLEN];
+	bool found = false;
+	FILE *f = fopen("/proc/net/arp", "r");
+
+	if (f == NULL)
+		return false;
+
+	inet_ntop(AF_INET, &ip, want, sizeof want);
+	while (!found && fgets(line, sizeof line, f) != NULL) {
+		if (sscanf(line, "%63s %*s %*s %63s %*s %16s", addr, hw, dev) == 3 &&
+			strcmp(addr, want) == 0 && strcmp(dev, ifname) == 0)
+			found = parse_mac(hw, mac);
+	}
+	fclose(f);
+	return found;
+}
+
+/**
+ * build the frame template and the partial checksums from the
+ * interface, the data socket's source port and the server address
+ */
+static bool raw_template(struct jana_config *cfg, struct raw_tx *r, int sockfd)
+{
+	struct ifreq ifr;
+	struct sockaddr_in local;
+	socklen_t local_len = sizeof local;
+	uint8_t dst_mac[6];
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+	if (fd < 0) {
+		log_perror(cfg->log, "raw_template: failed to create socket");
+		return false;
+	}
+
+	memset(&ifr, 0, sizeof ifr);
+	strncpy(ifr.ifr_name, cfg->raw_if, IFNAMSIZ - 1);
+
+	if (ioctl(fd, SIOCGIFHWADDR, &ifr) < 0) {
+		log_perror(cfg->log, "raw_template: SIOCGIFHWADDR");
+		close(fd);
+		return false;
+	}
+	memcpy(r->frame + 6, ifr.ifr_hwaddr.sa_data, 6);
+
+	if (ioctl(fd, SIOCGIFADDR, &ifr) < 0) {
+		log_perror(cfg->log, "raw_template: SIOCGIFADDR");
+		close(fd);
+		return false;
+	}
+	struct in_addr src = ((struct sockaddr_in*)&ifr.ifr_addr)->sin_addr;
+
+	if (ioctl(fd, SIOCGIFMTU, &ifr) < 0) {
+		log_perror(cfg->log, "raw_template: SIOCGIFMTU");
+		close(fd);
+		return false;
+	}
+	r->max_payload = ifr.ifr_mtu - 20 - 8;
+	close(fd);
+
+	if (cfg->raw_dst_mac != NULL ? !parse_mac(cfg->raw_dst_mac, dst_mac) :
+		!arp_lookup(cfg->addr.sin_addr, cfg->raw_if, dst_mac)) {
+		fprintf(cfg->log, "> raw: no mac for the server on %s, use --dst-mac\n", cfg->raw_if);
+		return false;
+	}
+	memcpy(r->frame, dst_mac, 6);
+
+	getsockname(sockfd, (struct sockaddr*)&local, &local_len);
+
+	uint8_t *eth = r->frame, *ip = eth + 14, *udp = ip + 20;
+	eth[12] = 0x08;
+	eth[13] = 0x00;
+
+	ip[0] = 0x45;
+	ip[6] = 0x40;     /* don't fragment, frames never exceed the mtu */
+	ip[8] = 64;
+	ip[9] = IPPROTO_UDP;
+	memcpy(ip + 12, &src, 4);
+	memcpy(ip + 16, &cfg->addr.sin_addr, 4);
+	r->ip_sum = csum_add(0, ip, 20);
+
+	memcpy(udp, &local.sin_port, 2);
+	memcpy(udp + 2, &cfg->addr.sin_port, 2);
+	r->udp_sum = csum_add(csum_add(0, ip + 12, 8), udp, 4) + IPPROTO_UDP;
+
+	if (r->max_payload > XDP_FRAME_LEN - RAW_HDR_LEN)
+		r->max_payload = XDP_FRAME_LEN - RAW_HDR_LEN;
+	return true;
+}
+
+/**
+ * patch a prebuilt frame for one packet, payload bytes past the id are zero
+ */
+static inline void raw_patch(struct raw_tx *r, uint8_t *frame, uint32_t packet_id, uint32_t len)
+{
+	uint8_t *ip = frame + 14, *udp = ip + 20;
+	uint16_t ip_len = htons(20 + 8 + len), udp_len = htons(8 + len);
+	uint32_t id = htonl(packet_id);
+
+	memcpy(ip + 2, &ip_len, 2);
+	memset(ip + 10, 0, 2);
+	uint16_t ip_csum = htons(csum_fold(r->ip_sum + 20 + 8 + len));
+	memcpy(ip + 10, &ip_csum, 2);
+
+	memcpy(udp + 4, &udp_len, 2);
+	memcpy(udp + 8, &id, 4);
+	uint16_t udp_csum = csum_fold(r->udp_sum + 2 * (8 + len) + (packet_id >> 16) + (packet_id & 0xffff));
+	udp_csum = htons(udp_csum == 0 ? 0xffff : udp_csum);
+	memcpy(udp + 6, &udp_csum, 2);
+}
+
+static int raw_bind_ll(int fd, const char *ifname, int protocol)
+{
+	struct sockaddr_ll ll;
+	memset(&ll, 0, sizeof ll);
+	ll.sll_family   = AF_PACKET;
+	ll.sll_protocol = protocol;
+	ll.sll_ifindex  = if_nametoindex(ifname);
+	return bind(fd, (struct sockaddr*)&ll, sizeof ll);
+}
+
+static bool raw_open_packet(struct jana_config *cfg, struct raw_tx *r)
+{
+	int version = TPACKET_V2;
+	struct tpacket_req req;
+
+	r->fd = socket(AF_PACKET, SOCK_RAW, 0);
+	if (r->fd < 0) {
+		log_perror(cfg->log, "raw_open: AF_PACKET socket (needs CAP_NET_RAW)");
+		return false;
+	}
+
+	// frames and blocks must be page multiples, tpacket2_hdr comes in front of the frame
+	r->frame_len = sysconf(_SC_PAGESIZE);
+	while (r->frame_len < XDP_FRAME_LEN + TPACKET_ALIGN(sizeof(struct tpacket2_hdr)))
+		r->frame_len *= 2;
+	req.tp_block_size = r->frame_len * 8;
+	req.tp_frame_size = r->frame_len;
+	req.tp_frame_nr   = RAW_FRAMES;
+	req.tp_block_nr   = RAW_FRAMES / 8;
+
+	if (setsockopt(r->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof version) < 0 ||
+		setsockopt(r->fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof req) < 0) {
+		log_perror(cfg->log, "raw_open: PACKET_TX_RING");
+		return false;
+	}
+
+	r->map_len = (size_t)req.tp_block_size * req.tp_block_nr;
+	r->map = mmap(NULL, r->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, 0);
+	if (r->map == MAP_FAILED) {
+		log_perror(cfg->log, "raw_open: mmap tx ring");
+		return false;
+	}
+
+	// the qdisc is kept on purpose: captures on this host must see the frames
+	if (raw_bind_ll(r->fd, cfg->raw_if, 0) < 0) {
+		log_perror(cfg->log, "raw_open: bind");
+		return false;
+	}
+
+	for (uint32_t i = 0; i < RAW_FRAMES; ++i) {
+		uint8_t *f = r->map + (size_t)i * r->frame_len;
+		memcpy(f + TPACKET_ALIGN(sizeof(struct tpacket2_hdr)), r->frame, RAW_HDR_LEN);
+	}
+	return true;
+}
+
+static inline void raw_flush(struct raw_tx *r);
+
+#ifdef JANA_XDP
+static void *xdp_map_ring(struct raw_tx *r, int idx, struct xdp_ring_offset *off,
+	uint32_t n, size_t desc_size, off_t pgoff, struct xdp_ring *ring)
+{
+	r->rings_len[idx] = off->desc + n * desc_size;
+	r->rings[idx] = mmap(NULL, r->rings_len[idx], PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, r->fd, pgoff);
+	if (r->rings[idx] == MAP_FAILED) {
+		r->rings[idx] = NULL;
+		return NULL;
+	}
+
+	ring->producer = (uint32_t*)(r->rings[idx] + off->producer);
+	ring->consumer = (uint32_t*)(r->rings[idx] + off->consumer);
+	ring->desc     = r->rings[idx] + off->desc;
+	ring->mask     = n - 1;
+	ring->cached   = 0;
+	return ring->desc;
+}
+
+/**
+ * AF_XDP in copy (generic) mode on queue 0. tx needs no xdp program;
+ * frames leave through the driver directly, so unlike the TX_RING path
+ * a capture on this host does not see them, one on the server does.
+ */
+static bool raw_open_xdp(struct jana_config *cfg, struct raw_tx *r)
+{
+	struct xdp_umem_reg umem;
+	struct xdp_mmap_offsets off;
+	struct sockaddr_xdp sxdp;
+	socklen_t optlen = sizeof off;
+	uint32_t n = RAW_FRAMES;
+
+	r->fd = socket(AF_XDP, SOCK_RAW, 0);
+	if (r->fd < 0) {
+		log_perror(cfg->log, "raw_open: AF_XDP socket");
+		return false;
+	}
+
+	r->frame_len = XDP_FRAME_LEN;
+	r->map_len = (size_t)RAW_FRAMES * XDP_FRAME_LEN;
+	r->map = mmap(NULL, r->map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (r->map == MAP_FAILED) {
+		log_perror(cfg->log, "raw_open: umem");
+		return false;
+	}
+
+	memset(&umem, 0, sizeof umem);
+	umem.addr = (uintptr_t)r->map;
+	umem.len = r->map_len;
+	umem.chunk_size = XDP_FRAME_LEN;
+
+	if (setsockopt(r->fd, SOL_XDP, XDP_UMEM_REG, &umem, sizeof umem) < 0 ||
+		setsockopt(r->fd, SOL_XDP, XDP_UMEM_FILL_RING, &n, sizeof n) < 0 ||
+		setsockopt(r->fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &n, sizeof n) < 0 ||
+		setsockopt(r->fd, SOL_XDP, XDP_TX_RING, &n, sizeof n) < 0 ||
+		getsockopt(r->fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) < 0) {
+		log_perror(cfg->log, "raw_open: xdp setup");
+		return false;
+	}
+
+	if (xdp_map_ring(r, 0, &off.tx, n, sizeof(struct xdp_desc), XDP_PGOFF_TX_RING, &r->tx) == NULL ||
+		xdp_map_ring(r, 1, &off.cr, n, sizeof(uint64_t), XDP_UMEM_PGOFF_COMPLETION_RING, &r->cq) == NULL ||
+		xdp_map_ring(r, 2, &off.fr, n, sizeof(uint64_t), XDP_UMEM_PGOFF_FILL_RING, &r->fq) == NULL) {
+		log_perror(cfg->log, "raw_open: mmap xdp ring");
+		return false;
+	}
+
+	memset(&sxdp, 0, sizeof sxdp);
+	sxdp.sxdp_family   = AF_XDP;
+	sxdp.sxdp_ifindex  = if_nametoindex(cfg->raw_if);
+	sxdp.sxdp_queue_id = 0;
+	sxdp.sxdp_flags    = XDP_COPY;
+
+	if (bind(r->fd, (struct sockaddr*)&sxdp, sizeof sxdp) < 0) {
+		log_perror(cfg->log, "raw_open: bind xdp");
+		return false;
+	}
+
+	for (uint32_t i = 0; i < RAW_FRAMES; ++i)
+		memcpy(r->map + (size_t)i * XDP_FRAME_LEN, r->frame, RAW_HDR_LEN);
+	r->tx.cached = *r->tx.producer;
+	r->cq.cached = *r->cq.consumer;
+	return true;
+}
+
+/**
+ * take back the frames the kernel has finished with; completions come in
+ * submission order so a count is all that is needed
+ */
+static inline void xdp_reap(struct raw_tx *r)
+{
+	uint32_t prod = __atomic_load_n(r->cq.producer, __ATOMIC_ACQUIRE);
+	if (prod != r->cq.cached) {
+		r->outstanding -= prod - r->cq.cached;
+		r->cq.cached = prod;
+		__atomic_store_n(r->cq.consumer, prod, __ATOMIC_RELEASE);
+	}
+}
+#endif
+
+static void raw_close(struct raw_tx *r);
+
+/**
+ * NULL if the interface or the kernel does not play along
+ */
+static struct raw_tx *raw_open(struct jana_config *cfg, int sockfd)
+{
+	struct raw_tx *r = calloc(1, sizeof(struct raw_tx));
+	bool ok;
+
+	if (r == NULL)
+		return NULL;
+
+	r->fd = -1;
+	r->map = MAP_FAILED;
+	r->xdp = cfg->raw_xdp;
+	r->batch = cfg->raw_batch;
+	ok = raw_template(cfg, r, sockfd);
+
+#ifdef JANA_XDP
+	if (ok && r->xdp)
+		ok = raw_open_xdp(cfg, r);
+	else
+#endif
+	if (ok)
+		ok = raw_open_packet(cfg, r);
+
+	if (!ok) {
+		raw_close(r);
+		return NULL;
+	}
+
+	fprintf(cfg->log, "> raw: %s on %s, batches of %u, max payload %u B\n",
+		r->xdp ? "AF_XDP (copy mode)" : "PACKET_TX_RING", cfg->raw_if, r->batch, r->max_payload);
+	return r;
+}
+
+/**
+ * queue one packet, returns the payload length actually sent
+ */
+static inline ssize_t raw_send(struct raw_tx *r, uint32_t packet_id, uint32_t len)
+{
+	if (len > r->max_payload)
+		len = r->max_payload;
+
+#ifdef JANA_XDP
+	if (r->xdp) {
+		while (r->outstanding == RAW_FRAMES) {
+			raw_flush(r);
+			xdp_reap(r);
+		}
+
+		uint32_t idx = r->tx.cached & r->tx.mask;
+		uint8_t *frame = r->map + (size_t)idx * XDP_FRAME_LEN;
+		struct xdp_desc *desc = (struct xdp_desc*)r->tx.desc + idx;
+
+		raw_patch(r, frame, packet_id, len);
+		desc->addr = (uint64_t)idx * XDP_FRAME_LEN;
+		desc->len = RAW_HDR_LEN + len;
+		desc->options = 0;
+		r->tx.cached++;
+		r->outstanding++;
+	} else
+#endif
+	{
+		uint8_t *slot = r->map + (size_t)r->head * r->frame_len;
+		volatile struct tpacket2_hdr *hdr = (struct tpacket2_hdr*)slot;
+
+		// the ring is full until the kernel has sent this slot
+		while (hdr->tp_status != TP_STATUS_AVAILABLE) {
+			if (hdr->tp_status == TP_STATUS_WRONG_FORMAT) {
+				errno = EPROTO;
+				return -1;
+			}
+			raw_flush(r);
+		}
+
+		raw_patch(r, slot + TPACKET_ALIGN(sizeof(struct tpacket2_hdr)), packet_id, len);
+		hdr->tp_len = RAW_HDR_LEN + len;
+		__atomic_store_n(&hdr->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+		r->head = (r->head + 1) % RAW_FRAMES;
+	}
+
+	if (++r->pending >= r->batch)
+		raw_flush(r);
+
+	return len;
+}
+
+static inline void raw_flush(struct raw_tx *r)
+{
+#ifdef JANA_XDP
+	if (r->xdp) {
+		__atomic_store_n(r->tx.producer, r->tx.cached, __ATOMIC_RELEASE);
+		sendto(r->fd, NULL, 0, MSG_DONTWAIT, NULL, 0);
+		xdp_reap(r);
+		r->pending = 0;
+		return;
+	}
+#endif
+	send(r->fd, NULL, 0, MSG_DONTWAIT);
+	r->pending = 0;
+}
+
+static void raw_close(struct raw_tx *r)
+{
+	if (r == NULL)
+		return;
+
+	if (r->map != MAP_FAILED) {
+		if (r->pending > 0)
+			raw_flush(r);
+		munmap(r->map, r->map_len);
+	}
+#ifdef JANA_XDP
+	for (int i = 0; i < 3; ++i)
+		if (r->rings[i] != NULL)
+			munmap(r->rings[i], r->rings_len[i]);
+#endif
+	if (r->fd >= 0)
+		close(r->fd);
+	free(r);
+}
+
+/**
+ * flow scenarios: many independent senders on one thread. a scenario
+ * file has one flow class per line,
+ *
+ *   count host:port rate-fn rate-cfg data-fn data-cfg start-us
+ *
+ * where host:port may be "-" for the server given with -c. every flow
+ * carries its own packet id followed by its flow id in the payload.
+ */
+struct flow_class
+{
+	uint32_t           count;
+	struct sockaddr_in addr;
+	pdf_rv_fn          wait_rv;
+	pdf_rv_fn          data_rv;
+	pdf_cfg_t          wait_pdf;
+	pdf_cfg_t          data_pdf;
+	uint64_t           start_us;
+
+	struct jana_hist   late;
+	uint64_t           packets;
+	uint64_t           bytes;
+};
+
+struct flow
+{
+	struct flow *next;
+	uint64_t     due;        /* departure, us since test start */
+	uint32_t     id;
+	uint32_t     cls;
+	uint32_t     packet_id;
+	uint64_t     bytes;
+	uint64_t     late_sum;   /* us */
+	uint32_t     late_max;
+};
+
+struct scenario
+{
+	uint32_t          n_classes;
+	uint32_t          n_flows;
+	struct flow_class classes[MAX_CLASSES];
+	struct flow      *flows;
+};
+
+static struct scenario *scenario_load(const char *path, struct sockaddr_in *server, FILE *log)
+{
+	FILE *f = fopen(path, "r");
+	if (f == NULL) {
+		log_perror(log, "scenario_load: failed to open scenario");
+		return NULL;
+	}
+
+	struct scenario *scn = calloc(1, sizeof(struct scenario));
+	if (scn == NULL) {
+		fclose(f);
+		return NULL;
+	}
+	char line[512];
+	uint32_t lineno = 0;
+
+	while (fgets(line, sizeof line, f) != NULL) {
+		char host[64], wait_fn[16], wait_cfg[64], data_fn[16], data_cfg[64];
+		struct flow_class *c = scn->classes + scn->n_classes;
+		unsigned long long start;
+		++lineno;
+
+		char *p = line + strspn(line, " \t");
+		if (*p == '#' || *p == '\n' || *p == '\0')
+			continue;
+
+		if (scn->n_classes == MAX_CLASSES) {
+			fprintf(log, "%s:%u: too many flow classes (max %d)\n", path, lineno, MAX_CLASSES);
+			goto fail;
+		}
+
+		if (sscanf(p, "%u %63s %15s %63s %15s %63s %llu", &c->count, host,
+				wait_fn, wait_cfg, data_fn, data_cfg, &start) != 7 ||
+			!jana_parse_pdf(wait_fn, wait_cfg, &c->wait_rv, &c->wait_pdf) ||
+			!jana_parse_pdf(data_fn, data_cfg, &c->data_rv, &c->data_pdf)) {
+			fprintf(log, "%s:%u: invalid flow class\n", path, lineno);
+			goto fail;
+		}
+
+		c->addr = *server;
+		if (strcmp(host, "-") != 0) {
+			char *colon = strchr(host, ':');
+			if (colon != NULL) {
+				*colon = '\0';
+				c->addr.sin_port = htons((uint16_t)atoi(colon + 1));
+			}
+			if (inet_pton(AF_INET, host, &c->addr.sin_addr) <= 0) {
+				fprintf(log, "%s:%u: invalid ipv4 address: %s\n", path, lineno, host);
+				goto fail;
+			}
+		}
+
+		c->start_us = start;
+		scn->n_flows += c->count;
+		scn->n_classes++;
+	}
+	fclose(f);
+	f = NULL;
+
+	if (scn->n_flows == 0 || scn->n_flows > MAX_FLOWS) {
+		fprintf(log, "%s: scenario must have 1 to %d flows\n", path, MAX_FLOWS);
+		goto fail;
+	}
+
+	scn->flows = calloc(scn->n_flows, sizeof(struct flow));
+	if (scn->flows == NULL) {
+		log_perror(log, "scenario_load: failed to allocate flows");
+		goto fail;
+	}
+
+	return scn;
+
+fail:
+	if (f != NULL)
+		fclose(f);
+	free(scn);
+	return NULL;
+}
+
+/**
+ * hierarchical timer wheel in 1 us ticks. level l holds the flows due
+ * within 256^(l+1) ticks; a level 0 slot is fired when `now` reaches it
+ * and the matching higher level slot is cascaded down every 256^l ticks,
+ * so insert and expiry are O(1) per event.
+ */
+#define WHEEL_BITS   (8)
+#define WHEEL_SLOTS  (1 << WHEEL_BITS)
+#define WHEEL_MASK   (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS (4)
+
+struct wheel
+{
+	uint64_t     now;
+	struct flow *slot[WHEEL_LEVELS][WHEEL_SLOTS];
+};
+
+static void wheel_insert(struct wheel *w, struct flow *f, bool cascade)
+{
+	uint64_t max = ((uint64_t)1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+	uint64_t earliest = cascade ? w->now : w->now + 1;
+	int level = 0;
+
+	// a departure in the past goes out on the next tick, but one cascaded
+	// down on its own tick lands in the level 0 slot about to be fired
+	if (f->due < earliest)
+		f->due = earliest;
+	if (f->due - w->now > max)
+		f->due = w->now + max;
+
+	uint64_t delta = f->due - w->now;
+	while (level < WHEEL_LEVELS - 1 && delta >= ((uint64_t)1 << (WHEEL_BITS * (level + 1))))
+		level++;
+
+	struct flow **head = &w->slot[level][(f->due >> (WHEEL_BITS * level)) & WHEEL_MASK];
+	f->next = *head;
+	*head = f;
+}
+
+/**
+ * move one tick forward and return the list of flows due on it
+ */
+static struct flow *wheel_advance(struct wheel *w)
+{
+	w->now++;
+
+	for (int level = 1; level < WHEEL_LEVELS; ++level) {
+		if ((w->now & ((1ULL << (WHEEL_BITS * level)) - 1)) != 0)
+			break;
+
+		struct flow **head = &w->slot[level][(w->now >> (WHEEL_BITS * level)) & WHEEL_MASK];
+		struct flow *f = *head;
+		*head = NULL;
+		while (f != NULL) {
+			struct flow *next = f->next;
+			wheel_insert(w, f, true);
+			f = next;
+		}
+	}
+
+	struct flow **head = &w->slot[0][w->now & WHEEL_MASK];
+	struct flow *due = *head;
+	*head = NULL;
+	return due;
+}
+
+/**
+ * run all flows of a scenario for the test duration over a pool of
+ * sockets, then write one log line per flow
+ */
+static void scenario_run(struct jana *j, struct scenario *scn, int *pool, uint32_t n_pool)
+{
+	struct jana_config *cfg = &j->cfg;
+	FILE *out = cfg->out;
+	uint8_t *payload = j->buf;
+	struct wheel *w = calloc(1, sizeof(struct wheel));
+
+	if (w == NULL) {
+		log_perror(cfg->log, "scenario_run: failed to allocate timer wheel");
+		return;
+	}
+
+	for (uint32_t c = 0, id = 0; c < scn->n_classes; ++c) {
+		struct flow_class *fc = scn->classes + c;
+		hist_reset(&fc->late);
+		fc->packets = fc->bytes = 0;
+
+		for (uint32_t i = 0; i < fc->count; ++i, ++id) {
+			struct flow *f = scn->flows + id;
+			memset(f, 0, sizeof *f);
+			f->id  = id;
+			f->cls = c;
+			// random phase within the first gap so equal flows do not start in lockstep
+			f->due = fc->start_us + (uint64_t)(fc->wait_rv(&fc->wait_pdf, &j->seed) * rand1(&j->seed));
+			wheel_insert(w, f, false);
+		}
+	}
+
+	uint64_t start = tick_now();
+	uint64_t end_us = (uint64_t)cfg->testtime * 1000000;
+	uint64_t n_sent = 0;
+
+	fprintf(cfg->log, "\r> running %u flows ...", scn->n_flows);
+	live_set(&j->live.tx_pkts, 0);
+	live_set(&j->live.tx_bytes, 0);
+	atomic_store(&j->live.in_test, true);
+	while (w->now < end_us && !stopping(j)) {
+		uint64_t target = tick_to_ns(tick_now() - start) / 1000;
+		if (target > end_us)
+			target = end_us;
+
+		while (w->now < target) {
+			struct flow *f = wheel_advance(w);
+
+			while (f != NULL) {
+				struct flow *next = f->next;
+				struct flow_class *fc = scn->classes + f->cls;
+				uint32_t len = 2 * sizeof(uint32_t) + (uint32_t)fc->data_rv(&fc->data_pdf, &j->seed);
+				if (len > MAX_PKT_SIZE)
+					len = MAX_PKT_SIZE;
+
+				((uint32_t*)payload)[0] = htonl(f->packet_id);
+				((uint32_t*)payload)[1] = htonl(f->id);
+
+				sendto(pool[f->id % n_pool], payload, len, 0,
+					(struct sockaddr*)&fc->addr, sizeof(struct sockaddr_in));
+
+				uint64_t late = target - f->due;
+				hist_add(&fc->late, late * 1000);
+				f->late_sum += late;
+				if (late > f->late_max)
+					f->late_max = (uint32_t)late;
+				f->packet_id++;
+				f->bytes += len;
+				fc->packets++;
+				fc->bytes += len;
+				n_sent++;
+				live_set(&j->live.tx_pkts, n_sent);
+
+				f->due += (uint64_t)fc->wait_rv(&fc->wait_pdf, &j->seed);
+				wheel_insert(w, f, false);
+				f = next;
+			}
+		}
+	}
+	atomic_store(&j->live.in_test, false);
+	fprintf(cfg->log, "\r> network test is done (%" PRIu64 " packets sent by %u flows)\n",
+		n_sent, scn->n_flows);
+
+	for (uint32_t c = 0; c < scn->n_classes; ++c) {
+		struct flow_class *fc = scn->classes + c;
+		fprintf(cfg->out, "> class %u: %u flows, %" PRIu64 " pkts (%" PRIu64 " B), %.1f pps\n",
+			c, fc->count, fc->packets, fc->bytes, fc->packets / (double)cfg->testtime);
+		hist_print(out, "departure late", &fc->late);
+	}
+
+	free(w);
+
+	if (cfg->logfile == NULL)
+		return;
+
+	fprintf(cfg->log, "> %s ...", cfg->logfile);
+	FILE *logfd = fopen(cfg->logfile, "w");
+	if (logfd == NULL) {
+		log_perror(cfg->log, "scenario_run: failed to open logfile");
+		return;
+	}
+	fprintf(logfd, "flow,class,packets,bytes,late_mean_us,late_max_us\n");
+	for (uint32_t i = 0; i < scn->n_flows; ++i) {
+		struct flow *f = scn->flows + i;
+		fprintf(logfd, "%u,%u,%u,%" PRIu64 ",%.1f,%u\n", f->id, f->cls, f->packet_id, f->bytes,
+			f->packet_id ? (double)f->late_sum / f->packet_id : 0.0, f->late_max);
+	}
+	fclose(logfd);
+	fprintf(cfg->log, "\r> %s...DONE\n", cfg->logfile);
+}
+
+/**
+ * trace replay: a schedule written by `pcap2csv -w` is mapped read-only
+ * and walked sequentially, so only the pages in use are resident and a
+ * long trace costs address space rather than memory.
+ */
+struct replay
+{
+	const sched_hdr_t *hdr;
+	const sched_rec_t *rec;
+	size_t             len;
+	double             ns_per_us;   /* replay ns per trace us */
+};
+
+static void replay_close(struct replay *r);
+
+static bool replay_open(struct jana_config *cfg, struct replay *r)
+{
+	struct stat st;
+	int fd = open(cfg->replay, O_RDONLY);
+
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		log_perror(cfg->log, "replay_open: failed to open schedule");
+		if (fd >= 0)
+			close(fd);
+		return false;
+	}
+
+	r->len = st.st_size;
+	r->hdr = mmap(NULL, r->len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (r->hdr == MAP_FAILED) {
+		log_perror(cfg->log, "replay_open: failed to map schedule");
+		r->hdr = NULL;
+		return false;
+	}
+
+	if (r->len < sizeof(sched_hdr_t) || r->hdr->magic != SCHED_MAGIC ||
+		r->hdr->version != SCHED_VERSION || r->hdr->count == 0 ||
+		r->hdr->count > (r->len - sizeof(sched_hdr_t)) / sizeof(sched_rec_t)) {
+		fprintf(cfg->log, "%s: not a replay schedule\n", cfg->replay);
+		replay_close(r);
+		return false;
+	}
+
+	r->rec = (const sched_rec_t*)(r->hdr + 1);
+	madvise((void*)r->hdr, r->len, MADV_SEQUENTIAL);
+
+	r->ns_per_us = 1000.0 / cfg->replay_speed;
+	if (cfg->replay_pps > 0 && r->hdr->duration_us > 0) {
+		double trace_pps = r->hdr->count * 1e6 / r->hdr->duration_us;
+		r->ns_per_us = 1000.0 * trace_pps / cfg->replay_pps;
+	}
+
+	fprintf(cfg->log, "> replay %s: %" PRIu64 " packets over %.3f s, played over %.3f s\n",
+		cfg->replay, r->hdr->count, r->hdr->duration_us / 1e6,
+		r->hdr->duration_us * r->ns_per_us / 1e9);
+	return true;
+}
+
+static void replay_close(struct replay *r)
+{
+	if (r->hdr != NULL)
+		munmap((void*)r->hdr, r->len);
+	r->hdr = NULL;
+}
+
+//
+// SWEEP
+//
+// a size x rate matrix, one cell per test of the keepalive loop. every
+// cell is warmed up with packets the server drops, then measured like a
+// normal test; the server answers the END of each test with
+//
+//   RSLT <packets sent> <rx packets> <rx bytes> <lost> <span ns>
+//
+// on the control socket, which the client matches by the sent count.
+//
+
+#define RSLT_WAIT_MS (3000)
+
+struct sweep_cell
+{
+	uint32_t    size;         /* udp payload bytes */
+	double      rate;         /* pps, 0 for unpaced */
+	double      gap;          /* ticks */
+
+	uint32_t    sent;
+	uint64_t    tx_span;      /* ns */
+	uint64_t    errors;
+	double      send_mean;    /* ns */
+	uint64_t    send_p99;     /* ns */
+
+	bool        has_rx;
+	uint64_t    rx_pkts;
+	uint64_t    rx_bytes;
+	uint64_t    lost;
+	uint64_t    rx_span;      /* ns */
+};
+
+static struct sweep_cell *sweep_cells(struct jana_config *cfg, uint32_t min_len)
+{
+	uint32_t n = cfg->n_sweep_sizes * cfg->n_sweep_rates;
+	struct sweep_cell *cells = calloc(n, sizeof(struct sweep_cell));
+
+	if (cells == NULL)
+		return NULL;
+
+	for (uint32_t s = 0; s < cfg->n_sweep_sizes; ++s)
+		for (uint32_t r = 0; r < cfg->n_sweep_rates; ++r) {
+			struct sweep_cell *c = cells + s * cfg->n_sweep_rates + r;
+			c->size = cfg->sweep_sizes[s];
+			if (c->size < min_len)
+				c->size = min_len;
+			if (c->size > MAX_PKT_SIZE)
+				c->size = MAX_PKT_SIZE;
+			c->rate = cfg->sweep_rates[r];
+			c->gap = c->rate > 0 ? 1e9 / c->rate / ticks.ns_per_tick : 0;
+		}
+
+	return cells;
+}
+
+/**
+ * largest udp payload that leaves without ip fragmentation, from the
+ * path mtu of a socket connected to the server
+ */
+static uint32_t sweep_max_unfragmented(struct sockaddr_in *peer)
+{
+	int mtu = 0;
+	socklen_t len = sizeof mtu;
+	int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+	if (fd < 0)
+		return 0;
+	if (connect(fd, (struct sockaddr*)peer, sizeof(struct sockaddr_in)) < 0 ||
+		getsockopt(fd, IPPROTO_IP, IP_MTU, &mtu, &len) < 0)
+		mtu = 0;
+	close(fd);
+
+	return mtu > 28 ? (uint32_t)mtu - 28 : 0;
+}
+
+/**
+ * warm caches, queues and cpu clocks at the rate and size of the cell.
+ * 'W' is never the first byte of a packet id, the server drops these.
+ */
+static void sweep_warmup(struct jana *j, int sockfd, struct sweep_cell *c)
+{
+	uint64_t until = tick_now() + tick_from_ns((uint64_t)j->cfg.sweep_warmup_ms * 1000000);
+	double due = tick_now();
+
+	j->buf[0] = 'W';
+	while (tick_now() < until && !stopping(j)) {
+		if (c->gap > 0) {
+			due += c->gap;
+			tick_sleep_until((uint64_t)due);
+		}
+		sendto(sockfd, j->buf, c->size, 0, (struct sockaddr*)&j->cfg.addr, sizeof(struct sockaddr_in));
+	}
+}
+
+static bool sweep_result(int heartfd, struct sweep_cell *c)
+{
+	char msg[100];
+	struct pollfd pfd = { .fd = heartfd, .events = POLLIN };
+	uint64_t until = tick_now() + tick_from_ns((uint64_t)RSLT_WAIT_MS * 1000000);
+
+	while (tick_now() < until) {
+		if (poll(&pfd, 1, 100) <= 0)
+			continue;
+
+		int len = recvfrom(heartfd, msg, sizeof msg - 1, 0, NULL, NULL);
+		if (len <= 0)
+			continue;
+		msg[len] = '\0';
+
+		unsigned int sent;
+		unsigned long long rx_pkts, rx_bytes, lost, span;
+		if (sscanf(msg, "RSLT %u %llu %llu %llu %llu", &sent, &rx_pkts, &rx_bytes, &lost, &span) != 5 ||
+			sent != c->sent)
+			continue;
+
+		c->has_rx   = true;
+		c->rx_pkts  = rx_pkts;
+		c->rx_bytes = rx_bytes;
+		c->lost     = lost;
+		c->rx_span  = span;
+
+		// the repeats follow right behind, they must not reach the next HELLO loop
+		while (poll(&pfd, 1, 10) > 0 &&
+			recvfrom(heartfd, msg, 4, MSG_PEEK, NULL, NULL) == 4 && memcmp(msg, "RSLT", 4) == 0)
+			recvfrom(heartfd, msg, sizeof msg, 0, NULL, NULL);
+		return true;
+	}
+
+	return false;
+}
+
+static inline double sweep_loss(struct sweep_cell *c)
+{
+	return c->sent ? 100.0 * c->lost / c->sent : 0.0;
+}
+
+/**
+ * loss a fragmenting cell has on top of the largest unfragmented size
+ * at the same rate, false if there is nothing to compare against
+ */
+static bool sweep_frag_loss(struct jana_config *cfg, struct sweep_cell *cells, uint32_t i,
+	uint32_t max_unfrag, double *frag)
+{
+	struct sweep_cell *c = cells + i, *base = NULL;
+
+	if (max_unfrag == 0 || c->size <= max_unfrag || !c->has_rx)
+		return false;
+
+	for (uint32_t s = 0; s < cfg->n_sweep_sizes; ++s) {
+		struct sweep_cell *b = cells + s * cfg->n_sweep_rates + i % cfg->n_sweep_rates;
+		if (b->size <= max_unfrag && b->has_rx && (base == NULL || b->size > base->size))
+			base = b;
+	}
+
+	if (base == NULL)
+		return false;
+
+	*frag = sweep_loss(c) - sweep_loss(base);
+	return true;
+}
+
+static void sweep_print(FILE *out, struct jana_config *cfg, struct sweep_cell *cells, uint32_t max_unfrag)
+{
+	fprintf(out, "> sweep: %u sizes x %u rates, %d s per cell, %u ms warm-up, unfragmented up to %u B\n",
+		cfg->n_sweep_sizes, cfg->n_sweep_rates, cfg->testtime, cfg->sweep_warmup_ms, max_unfrag);
+	fprintf(out, ">   %6s %10s %10s %10s %10s %8s %8s %10s %10s %7s\n", "size", "rate",
+		"tx pps", "rx pps", "Mbit/s", "loss%", "frag%", "send ns", "send p99", "errors");
+
+	for (uint32_t i = 0; i < cfg->n_sweep_sizes * cfg->n_sweep_rates; ++i) {
+		struct sweep_cell *c = cells + i;
+		double frag;
+		char rate[16];
+
+		if (c->rate > 0)
+			snprintf(rate, sizeof rate, "%.0f", c->rate);
+		else
+			snprintf(rate, sizeof rate, "max");
+
+		fprintf(out, ">   %6u %10s %10.0f", c->size, rate, c->tx_span ? c->sent * 1e9 / c->tx_span : 0.0);
+		if (c->has_rx)
+			fprintf(out, " %10.0f %10.3f %8.3f", c->rx_span ? c->rx_pkts * 1e9 / c->rx_span : 0.0,
+				c->rx_span ? c->rx_bytes * 8e3 / c->rx_span : 0.0, sweep_loss(c));
+		else
+			fprintf(out, " %10s %10s %8s", "-", "-", "-");
+		if (sweep_frag_loss(cfg, cells, i, max_unfrag, &frag))
+			fprintf(out, " %8.3f", frag);
+		else
+			fprintf(out, " %8s", "-");
+		fprintf(out, " %10.0f %10" PRIu64 " %7" PRIu64 "\n", c->send_mean, c->send_p99, c->errors);
+	}
+}
+
+static bool sweep_json(struct jana_config *cfg, struct sweep_cell *cells, uint32_t max_unfrag)
+{
+	FILE *fp = fopen(cfg->sweep_json, "w");
+	if (fp == NULL) {
+		log_perror(cfg->log, "sweep_json: failed to open file");
+		return false;
+	}
+
+	fprintf(fp, "{\"time\":%d,\"warmup_ms\":%u,\"max_unfragmented\":%u,\"cells\":[",
+		cfg->testtime, cfg->sweep_warmup_ms, max_unfrag);
+
+	for (uint32_t i = 0; i < cfg->n_sweep_sizes * cfg->n_sweep_rates; ++i) {
+		struct sweep_cell *c = cells + i;
+		double frag;
+
+		fprintf(fp, "%s\n{\"size\":%u,\"rate\":%.3f,\"tx_pkts\":%u,\"tx_pps\":%.3f,\"errors\":%" PRIu64 ","
+			"\"send_ns_mean\":%.3f,\"send_ns_p99\":%" PRIu64, i ? "," : "", c->size, c->rate, c->sent,
+			c->tx_span ? c->sent * 1e9 / c->tx_span : 0.0, c->errors, c->send_mean, c->send_p99);
+		if (c->has_rx)
+			fprintf(fp, ",\"rx_pkts\":%" PRIu64 ",\"rx_pps\":%.3f,\"goodput_mbps\":%.3f,\"loss_pct\":%.4f",
+				c->rx_pkts, c->rx_span ? c->rx_pkts * 1e9 / c->rx_span : 0.0,
+				c->rx_span ? c->rx_bytes * 8e3 / c->rx_span : 0.0, sweep_loss(c));
+		else
+			fprintf(fp, ",\"rx_pkts\":null,\"rx_pps\":null,\"goodput_mbps\":null,\"loss_pct\":null");
+		if (sweep_frag_loss(cfg, cells, i, max_unfrag, &frag))
+			fprintf(fp, ",\"frag_loss_pct\":%.4f}", frag);
+		else
+			fprintf(fp, ",\"frag_loss_pct\":null}");
+	}
+
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+	return true;
+}
+
+static int run_client(struct jana *j)
+{
+	struct jana_config *cfg = &j->cfg;
+	FILE *out = cfg->out, *log = cfg->log;
+	uint8_t *zero_bytes = j->buf;
+	int result = -1;
+
+	struct sockaddr_in local_addr;
+	local_addr.sin_family = AF_INET;
+	local_addr.sin_addr.s_addr = INADDR_ANY;
+	local_addr.sin_port = 0;
+
+	char str[INET_ADDRSTRLEN];
+	inet_ntop(AF_INET, &(cfg->addr.sin_addr), str, INET_ADDRSTRLEN);
+	fprintf(out, "> using %s:%d\n", str, ntohs(cfg->addr.sin_port));
+
+	int heartfd = init_socket(&local_addr, true, log);
+	int sockfd = init_socket(&local_addr, false, log);
+
+	struct scenario *scn = NULL;
+	int *pool = NULL;
+	struct replay replay = { NULL, NULL, 0, 0 };
+
+	uint32_t packet_id, n_packets = MAX_PACKETS;
+	struct packet_log plog = { NULL, NULL, MAX_PACKETS, 0, NULL };
+	uint32_t *wait_rvs = NULL;
+	uint32_t *data_rvs = NULL;
+
+	struct clock_sync sync_before, sync_after;
+	struct clock_model clock;
+	bool ready;
+	int tcpfd = -1;
+	struct raw_tx *raw = NULL;
+	struct sweep_cell *sweep = NULL;
+	uint32_t cell = 0, max_unfrag = 0;
+	bool mcast = IN_MULTICAST(ntohl(cfg->addr.sin_addr.s_addr));
+	struct receivers rcv;
+
+	if (heartfd < 0 || sockfd < 0)
+		goto cleanup;
+
+	if (mcast && (!mcast_sender(heartfd, cfg) || !mcast_sender(sockfd, cfg)))
+		goto cleanup;
+
+	if (cfg->replay != NULL && !replay_open(cfg, &replay))
+		goto cleanup;
+
+	// a replay sends its schedule once, and logs it a window at a time
+	if (replay.hdr != NULL) {
+		n_packets = replay.hdr->count < UINT32_MAX ? (uint32_t)replay.hdr->count : UINT32_MAX;
+		plog.cap = n_packets < LOG_WINDOW ? n_packets : LOG_WINDOW;
+	}
+
+	plog.ttime = calloc(plog.cap, sizeof(uint64_t));
+	plog.delay = calloc(plog.cap, sizeof(uint64_t));
+	if (replay.hdr == NULL) {
+		wait_rvs = calloc(n_packets, sizeof(uint32_t));
+		data_rvs = calloc(n_packets, sizeof(uint32_t));
+	}
+	if (plog.ttime == NULL || plog.delay == NULL ||
+		(replay.hdr == NULL && (wait_rvs == NULL || data_rvs == NULL))) {
+		log_perror(log, "run_client: failed to allocate packet arrays");
+		goto cleanup;
+	}
+
+	if (cfg->n_sweep_sizes > 0) {
+		sweep = sweep_cells(cfg, cfg->verify ? PAYLOAD_MIN_VERIFY : sizeof(uint32_t));
+		if (sweep == NULL) {
+			log_perror(log, "run_client: failed to allocate sweep");
+			goto cleanup;
+		}
+		max_unfrag = sweep_max_unfragmented(&cfg->addr);
+	}
+
+	if (cfg->scenario != NULL) {
+		if ((scn = scenario_load(cfg->scenario, &cfg->addr, log)) == NULL ||
+			(pool = malloc(cfg->n_sockets * sizeof(int))) == NULL)
+			goto cleanup;
+		for (uint32_t i = 0; i < cfg->n_sockets; ++i)
+			pool[i] = -1;
+		for (uint32_t i = 0; i < cfg->n_sockets; ++i)
+			if ((pool[i] = init_socket(&local_addr, false, log)) < 0)
+				goto cleanup;
+		fprintf(log, "> scenario %s: %u classes, %u flows over %u sockets\n",
+			cfg->scenario, scn->n_classes, scn->n_flows, cfg->n_sockets);
+	}
+
+	if (cfg->wait_rv && wait_rvs != NULL) {
+		fprintf(log, "> generating delay distribution...");
+		for (size_t i = 0; i < n_packets; ++i)
+			wait_rvs[i] = cfg->wait_rv(&cfg->wait_pdf, &j->seed);
+		fprintf(log, "OK\n");
+	}
+
+	if (cfg->data_rv != NULL && data_rvs != NULL) {
+		fprintf(log, "> generating data distribution...");
+		for (size_t i = 0; i < n_packets; ++i)
+			data_rvs[i] = cfg->data_rv(&cfg->data_pdf, &j->seed);
+		fprintf(log, "OK\n");
+	}
+
+	if (cfg->rt) {
+		rt_enter(cfg);
+		rt_prefault(plog.delay, plog.cap * sizeof(uint64_t));
+		rt_prefault(plog.ttime, plog.cap * sizeof(uint64_t));
+		if (wait_rvs != NULL) {
+			rt_prefault(wait_rvs, n_packets * sizeof(uint32_t));
+			rt_prefault(data_rvs, n_packets * sizeof(uint32_t));
+		}
+		rt_prefault(zero_bytes, MAX_PKT_SIZE);
+	}
+
+	result = 0;
+
+init_phase:
+	ready = false;
+	memset(&sync_before, 0, sizeof sync_before);
+	memset(&sync_after, 0, sizeof sync_after);
+	memset(&rcv, 0, sizeof rcv);
+
+	{
+		uint32_t i = 0;
+		do {
+			if (stopping(j))
+				goto cleanup;
+
+			fprintf(log, "\r> registering ");
+			fprintf(log, "%s", SPINNER[i % 4]);
+
+			// about once a second, the first one may land in the drain of the last test
+			if (i++ % 8 == 0) {
+				static const char *MSG = "HELLO";
+				sendto(heartfd, MSG, strlen(MSG)+1, 0, (struct sockaddr*)&cfg->addr, sizeof(struct sockaddr_in));
+			}
+
+			usleep(120*1000);
+		} while (mcast ? !receivers_poll(heartfd, &rcv, cfg->receivers, false) :
+			!read_message(heartfd, "HELLO", 0));
+		if (mcast)
+			fprintf(log, "\r> registering OK (%u receivers)\n", rcv.n_hello);
+		else
+			fprintf(log, "\r> registering OK\n");
+	}
+
+	// probes to a group would be answered by every receiver
+	if (cfg->sync_probes > 0 && cfg->mode != jana_dummy && !mcast) {
+		fprintf(log, "> syncing clocks ...");
+		if (clock_sync(heartfd, &cfg->addr, cfg->sync_probes, &sync_before, &ready))
+			fprintf(log, "\r> syncing clocks OK (%u probes)\n", sync_before.probes);
+		else
+			fprintf(log, "\r> syncing clocks FAILED, using raw clock\n");
+	}
+
+	if (!ready) {
+		uint32_t i = 0;
+		do {
+			if (i > 300) {
+				fprintf(log, "\r> timeout after 36 s\n");
+				goto init_phase;
+			}
+			if (stopping(j))
+				goto cleanup;
+
+			fprintf(log, "\r> waiting to start ");
+			fprintf(log, "%s", SPINNER[i++ % 4]);
+
+			usleep(120*1000);
+		} while (mcast ? !receivers_poll(heartfd, &rcv, cfg->receivers, true) :
+			!read_message(heartfd, "READY", 0));
+	}
+	fprintf(log, "\r> got the ready signal\n");
+
+	usleep(500*1000);
+
+	if (cfg->mode == jana_dummy) {
+		fprintf(log, "> in dummy mode, exiting\n");
+		goto cleanup;
+	}
+
+	if (cfg->tcp) {
+		tcpfd = tcp_connect(&cfg->addr, log);
+		if (tcpfd < 0)
+			goto init_phase;
+	}
+
+	if (cfg->raw_if != NULL && (raw = raw_open(cfg, sockfd)) == NULL) {
+		result = -1;
+		goto cleanup;
+	}
+
+	{
+		static const char *MSG = "SETGO";
+		sendto(sockfd, MSG, strlen(MSG)+1, 0,
+					(struct sockaddr*)(&cfg->addr),
+					sizeof(struct sockaddr_in));
+	}
+
+	if (sweep != NULL)
+		sweep_warmup(j, sockfd, sweep + cell);
+	else
+		usleep(500*1000);
+
+	if (scn != NULL) {
+		scenario_run(j, scn, pool, cfg->n_sockets);
+		live_set(&j->live.tests, atomic_load(&j->live.tests) + 1);
+
+		if (cfg->keepalive && !stopping(j))
+			goto init_phase;
+		goto cleanup;
+	}
+
+	{
+		struct rt_window rtw;
+		struct perf_window pw;
+		struct tcp_stats tcpi;
+		uint32_t data_len;
+		uint64_t deadline, next_sample;
+		uint64_t n_eagain = 0, n_enobufs = 0, n_error = 0, tx_bytes = 0;
+		uint32_t min_len = tcpfd >= 0 ? sizeof(struct msg_hdr) :
+			cfg->verify ? PAYLOAD_MIN_VERIFY : mcast ? PAYLOAD_MIN_STAMP : sizeof(uint32_t);
+		int64_t  send_offset_ns = sync_before.valid ? sync_before.offset_ns : 0;
+
+		packet_id = 0;
+		plog.base = 0;
+		if (plog.spill != NULL) {
+			fclose(plog.spill);
+			plog.spill = NULL;
+		}
+		tcp_stats_reset(&tcpi);
+		live_set(&j->live.tx_pkts, 0);
+		live_set(&j->live.tx_bytes, 0);
+		live_set(&j->live.tx_errors, 0);
+		atomic_store(&j->live.in_test, true);
+
+		if (cfg->rt)
+			rt_window_begin(&rtw);
+		if (cfg->perf)
+			perf_window_begin(&pw, log);
+
+		tick_rebase(&j->base);
+		deadline = tick_now() + tick_from_ns((uint64_t)cfg->testtime * 1000000000);
+		double due = tick_now(), start = due;
+		uint64_t prev_end = (uint64_t)start;
+		next_sample = tick_now();
+
+		if (sweep != NULL)
+			fprintf(log, "\r> sweep %u/%u: %u B at %.0f pps\n", cell + 1,
+				cfg->n_sweep_sizes * cfg->n_sweep_rates, sweep[cell].size, sweep[cell].rate);
+		fprintf(log, "\r> running test ...");
+		for (;;) {
+			uint32_t *data = (uint32_t*)zero_bytes;
+			*data = htonl(packet_id);
+
+			// queued frames must not wait out a pacing gap
+			if (raw != NULL && raw->pending > 0 && (cfg->wait_rv || replay.hdr != NULL))
+				raw_flush(raw);
+
+			if (replay.hdr != NULL) {
+				const sched_rec_t *rec = replay.rec + packet_id;
+				data_len = rec->size < min_len ? min_len : rec->size;
+			} else if (sweep != NULL) {
+				data_len = sweep[cell].size;
+			} else {
+				data_len = min_len + data_rvs[packet_id];
+			}
+
+			if (data_len > MAX_PKT_SIZE)
+				data_len = MAX_PKT_SIZE;
+
+			if (cfg->verify)
+				payload_seal(zero_bytes, packet_id, data_len, cfg->verify_seed);
+
+			if (replay.hdr != NULL) {
+				// departures are absolute so sleep overshoot does not add up
+				due += replay.rec[packet_id].gap_us * replay.ns_per_us / ticks.ns_per_tick;
+				tick_sleep_until((uint64_t)due);
+			} else if (sweep != NULL && sweep[cell].gap > 0) {
+				due += sweep[cell].gap;
+				tick_sleep_until((uint64_t)due);
+			} else if (cfg->wait_rv) {
+				// absolute too, but a stall is made up by one gap at most
+				due = pace_due(due, prev_end, wait_rvs[packet_id]);
+				tick_sleep_until((uint64_t)due);
+			}
+
+			uint64_t t0 = tick_now();
+			ssize_t sent;
+
+			if (tcpfd >= 0) {
+				struct msg_hdr *h = (struct msg_hdr*)zero_bytes;
+				uint64_t ns = (uint64_t)(clock_now_ns(CLOCK_REALTIME) + send_offset_ns);
+				h->len     = htonl(data_len);
+				h->id      = htonl(packet_id);
+				h->send_hi = htonl((uint32_t)(ns >> 32));
+				h->send_lo = htonl((uint32_t)ns);
+
+				sent = tcp_send_all(tcpfd, zero_bytes, data_len, deadline, &tcpi) ? (ssize_t)data_len : -1;
+			} else if (raw != NULL) {
+				sent = raw_send(raw, packet_id, data_len);
+			} else {
+				if (mcast)
+					payload_stamp(zero_bytes, clock_now_ns(CLOCK_REALTIME));
+				sent = sendto(sockfd,
+					zero_bytes,
+					data_len,
+					0, (struct sockaddr*)(&cfg->addr), sizeof(struct sockaddr_in));
+			}
+
+			uint64_t t1 = tick_now();
+
+			if (tcpfd >= 0 && t1 >= next_sample) {
+				tcp_sample(tcpfd, &tcpi);
+				next_sample = t1 + tick_from_ns(TCP_SAMPLE_NS);
+			}
+
+			if (sent > 0)
+				tx_bytes += sent;
+			else if (sent < 0) {
+				if (errno == EAGAIN || errno == EWOULDBLOCK)
+					n_eagain++;
+				else if (errno == ENOBUFS)
+					n_enobufs++;
+				else
+					n_error++;
+				live_set(&j->live.tx_errors, n_eagain + n_enobufs + n_error);
+			}
+
+			plog.ttime[packet_id - plog.base] = t0;
+			plog.delay[packet_id - plog.base] = t1 - t0;
+			prev_end = t1;
+			++packet_id;
+			live_set(&j->live.tx_pkts, packet_id);
+			live_set(&j->live.tx_bytes, tx_bytes);
+
+			// the send timestamp doubles as the deadline check
+			if (t1 >= deadline || packet_id >= n_packets || stopping(j))
+				break;
+			if (packet_id - plog.base == plog.cap && !packet_log_spill(&plog, plog.cap)) {
+				log_perror(log, "\r> packet log spill");
+				break;
+			}
+			if (tcpfd >= 0 && sent < 0) {
+				fprintf(log, "\r> tcp connection lost: %s\n", strerror(errno));
+				break;
+			}
+			if (raw != NULL && sent < 0) {
+				fprintf(log, "\r> raw: kernel rejected a frame\n");
+				break;
+			}
+		}
+		atomic_store(&j->live.in_test, false);
+		tick_rebase_end(&j->base);
+		fprintf(log, "\r> network test is done (%u packets sent)\n", packet_id);
+		if (replay.hdr != NULL && packet_id < replay.hdr->count)
+			fprintf(log, "> replay truncated: %" PRIu64 " of %" PRIu64 " packets not sent\n",
+				replay.hdr->count - packet_id, replay.hdr->count);
+		else if (replay.hdr == NULL && packet_id >= n_packets)
+			fprintf(log, "> test truncated at %u packets\n", n_packets);
+		if (plog.spill != NULL && !packet_log_spill(&plog, packet_id - plog.base))
+			log_perror(log, "> packet log spill");
+
+		if (raw != NULL) {
+			raw_close(raw);
+			raw = NULL;
+		}
+
+		// the tcp end of test: the server reads up to the FIN
+		if (tcpfd >= 0)
+			shutdown(tcpfd, SHUT_WR);
+
+		if (tcpfd < 0) {
+			char msg[100];
+			int64_t stop_ns = clock_now_ns(CLOCK_REALTIME) + send_offset_ns;
+			int len = snprintf(msg, sizeof msg, "END %u %lld %lld", packet_id, (long long)stop_ns,
+				sync_before.valid ? (long long)sync_before.rtt_ns / 2 : -1LL);
+			for (int i = 0; i < END_REPEAT; ++i) {
+				sendto(sockfd, msg, len+1, 0, (struct sockaddr*)&cfg->addr, sizeof(struct sockaddr_in));
+				usleep(1000);
+			}
+
+			if (sweep != NULL) {
+				sweep[cell].sent = packet_id;
+				if (!sweep_result(heartfd, sweep + cell))
+					fprintf(log, "> sweep: no result from the server\n");
+			}
+		}
+
+		if (tcpfd >= 0) {
+			tcp_sample(tcpfd, &tcpi);
+			close(tcpfd);
+			tcpfd = -1;
+			fprintf(out, "> tcp: %u messages\n", packet_id);
+			tcp_stats_print(out, &tcpi);
+		}
+
+		if (cfg->perf)
+			perf_window_end(&pw, out);
+		if (cfg->rt)
+			rt_window_end(&rtw, out);
+
+		struct client_hists ch;
+		FILE *store = NULL;
+
+		client_hists_begin(&ch, start);
+		for (uint32_t id = 0, n; (n = packet_log_window(&plog, id, packet_id)) > 0; id += n)
+			client_hists_add(cfg, &ch, n, plog.ttime, plog.delay, wait_rvs);
+		publish_hist(j, JANA_HIST_SEND, &ch.syscall);
+
+		if (sweep != NULL) {
+			sweep[cell].tx_span = ch.span;
+			sweep[cell].errors = n_eagain + n_enobufs + n_error;
+			sweep[cell].send_mean = ch.syscall.count ? (double)ch.syscall.sum / ch.syscall.count : 0.0;
+			sweep[cell].send_p99 = jana_hist_quantile(&ch.syscall, 0.99);
+		}
+		if (cfg->wait_rv)
+			publish_hist(j, JANA_HIST_PACING, &ch.pacing);
+
+		if (cfg->overhead) {
+			client_overhead(cfg, &ch);
+			fprintf(out, ">   errors         %" PRIu64 " EAGAIN, %" PRIu64 " ENOBUFS, %" PRIu64 " other\n",
+				n_eagain, n_enobufs, n_error);
+		}
+
+		if (cfg->store != NULL && (store = store_begin(cfg, "client")) != NULL) {
+			fprintf(store, " tx_pkts=%u tx_bytes=%" PRIu64 " tx_mbps=%.3f errors=%" PRIu64,
+				packet_id, tx_bytes, ch.span ? tx_bytes * 8e3 / ch.span : 0.0,
+				n_eagain + n_enobufs + n_error);
+			store_hist(store, "send_us", &ch.syscall, 1000.0);
+			if (cfg->wait_rv) {
+				store_hist(store, "pacing_us", &ch.pacing, 1000.0);
+				fprintf(store, " pacing_early=%" PRIu64, ch.early);
+			}
+			store_end(store);
+		}
+	}
+
+	if (sync_before.valid)
+		clock_sync(heartfd, &cfg->addr, cfg->sync_probes, &sync_after, NULL);
+
+	clock_model_fit(&clock, &sync_before, &sync_after);
+
+	if (clock.valid) {
+		fprintf(out, "> clock offset %+.1f us (+- %.1f us), rtt %.1f us, drift %+.3f ppm (+- %.3f ppm)\n",
+			clock.offset_ns / 1000.0, clock.error_ns / 1000.0, sync_before.rtt_ns / 1000.0,
+			clock.drift * 1e6, clock.drift_error * 1e6);
+	}
+
+	if (cfg->logfile != NULL && sweep == NULL) {
+		fprintf(log, "> %s ...", cfg->logfile);
+		FILE *logfd = fopen(cfg->logfile, "w");
+		if (logfd == NULL) {
+			log_perror(log, "run_client: failed to open logfile");
+			result = -1;
+			goto cleanup;
+		}
+		for (uint32_t id = 0, n; (n = packet_log_window(&plog, id, packet_id)) > 0; id += n)
+			write_log(logfd, id, n, plog.ttime, plog.delay, &j->base, &clock);
+		fclose(logfd);
+		fprintf(log, "\r> %s...DONE\n", cfg->logfile);
+	}
+
+	live_set(&j->live.tests, atomic_load(&j->live.tests) + 1);
+
+	if (sweep != NULL) {
+		if (++cell < cfg->n_sweep_sizes * cfg->n_sweep_rates && !stopping(j))
+			goto init_phase;
+
+		sweep_print(out, cfg, sweep, max_unfrag);
+		if (cfg->sweep_json != NULL && !sweep_json(cfg, sweep, max_unfrag))
+			result = -1;
+		goto cleanup;
+	}
+
+	if (cfg->keepalive && !stopping(j))
+		goto init_phase;
+
+cleanup:
+	free(sweep);
+	replay_close(&replay);
+	raw_close(raw);
+	if (tcpfd >= 0)
+		close(tcpfd);
+
+	if (pool != NULL) {
+		for (uint32_t i = 0; i < cfg->n_sockets; ++i)
+			if (pool[i] >= 0)
+				close(pool[i]);
+		free(pool);
+	}
+	if (scn != NULL) {
+		free(scn->flows);
+		free(scn);
+	}
+
+	if (sockfd >= 0)
+		close(sockfd);
+	if (heartfd >= 0)
+		close(heartfd);
+	free(data_rvs);
+	free(wait_rvs);
+	if (plog.spill != NULL)
+		fclose(plog.spill);
+	free(plog.delay);
+	free(plog.ttime);
+	return result;
+}
+
+/**
+ * live view of a udp server test: counters summed over the registered
+ * clients, and with `hists` their merged arrival histograms
+ */
+static void server_publish(struct jana *j, uint32_t registered, struct sockaddr_in *clients,
+	uint32_t *counters, uint64_t *recvdata, struct arrival *arrivals, struct integrity *integrity,
+	bool hists)
+{
+	uint64_t pkts = 0, bytes = 0, lost = 0, reordered = 0, corrupt = 0;
+	struct jana_hist gap, size, delay;
+
+	if (hists) {
+		hist_reset(&gap);
+		hist_reset(&size);
+		hist_reset(&delay);
+	}
+
+	for (uint32_t i = 0; i < registered; ++i) {
+		uint32_t f = chash(clients + i);
+		pkts += counters[f];
+		bytes += recvdata[f];
+		lost += arrival_lost(arrivals + f);
+		reordered += arrivals[f].reordered;
+		corrupt += integrity[f].corrupt + integrity[f].truncated;
+		if (hists) {
+			hist_merge(&gap, &arrivals[f].gap);
+			hist_merge(&size, &arrivals[f].size);
+			hist_merge(&delay, &arrivals[f].delay);
+		}
+	}
+
+	live_set(&j->live.rx_pkts, pkts);
+	live_set(&j->live.rx_bytes, bytes);
+	live_set(&j->live.rx_lost, lost);
+	live_set(&j->live.rx_reordered, reordered);
+	live_set(&j->live.rx_corrupt, corrupt);
+
+	if (hists) {
+		publish_hist(j, JANA_HIST_GAP, &gap);
+		publish_hist(j, JANA_HIST_SIZE, &size);
+		if (j->cfg.join)
+			publish_hist(j, JANA_HIST_LATENCY, &delay);
+	}
+}
+
+/**
+ * "RSLT <sent> <rx pkts> <rx bytes> <lost> <span ns>" to every client that
+ * sent END, for clients that need the server's view (sweeps)
+ */
+static void server_results(int sockfd, uint32_t registered, struct sockaddr_in *clients,
+	uint32_t *counters, uint64_t *recvdata, struct arrival *arrivals, struct drain *drains)
+{
+	char msg[100];
+
+	for (uint32_t i = 0; i < registered; ++i) {
+		uint32_t f = chash(clients + i);
+		struct arrival *a = arrivals + f;
+
+		if (!drains[f].ended)
+			continue;
+
+		int len = snprintf(msg, sizeof msg, "RSLT %u %u %" PRIu64 " %" PRIu64 " %" PRIu64,
+			drains[f].count, counters[f], recvdata[f], arrival_lost(a),
+			a->last > a->first ? tick_to_ns(a->last - a->first) : 0);
+		for (int k = 0; k < END_REPEAT; ++k)
+			sendto(sockfd, msg, len+1, 0, (struct sockaddr*)(clients + i), sizeof(struct sockaddr_in));
+	}
+}
+
+static void tcp_publish(struct jana *j, struct tcp_conn **conns, uint32_t n_conns)
+{
+	uint64_t msgs = 0, bytes = 0;
+	struct jana_hist latency;
+
+	hist_reset(&latency);
+	for (uint32_t i = 0; i < n_conns; ++i) {
+		msgs += conns[i]->msgs;
+		bytes += conns[i]->bytes;
+		hist_merge(&latency, &conns[i]->latency);
+	}
+
+	live_set(&j->live.rx_pkts, msgs);
+	live_set(&j->live.rx_bytes, bytes);
+	publish_hist(j, JANA_HIST_LATENCY, &latency);
+}
+
+/**
+ * tcp variant of the server test loop: accept and read all client
+ * connections through one epoll set until the deadline, and past it
+ * until every client closed its side, but never longer than DRAIN_MAX_NS
+ * (clients start sending after the server's deadline is set). returns
+ * the number of connections stored in `conns`.
+ */
+static uint32_t tcp_test(struct jana *j, int listenfd, uint64_t deadline, struct tcp_conn **conns,
+	uint32_t *counters, uint64_t *recvdata)
+{
+	struct epoll_event ev, events[64];
+	uint32_t n_conns = 0, n_open = 0;
+	uint64_t next_sample = tick_now();
+	uint64_t drain_limit = deadline + tick_from_ns(DRAIN_MAX_NS);
+	int epfd = epoll_create1(0);
+
+	if (epfd < 0) {
+		log_perror(j->cfg.log, "tcp_test: epoll_create1");
+		return 0;
+	}
+
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, listenfd, &ev);
+
+	uint64_t now;
+	while (((now = tick_now()) < deadline || (n_open > 0 && now < drain_limit)) && !stopping(j)) {
+		int n = epoll_wait(epfd, events, 64, 10);
+		int64_t now_ns = clock_now_ns(CLOCK_REALTIME);
+
+		for (int i = 0; i < n; ++i) {
+			struct tcp_conn *c = events[i].data.ptr;
+
+			if (c == NULL) {
+				struct sockaddr_in peer;
+				socklen_t peerlen = sizeof peer;
+				int fd;
+
+				while ((fd = accept(listenfd, (struct sockaddr*)&peer, &peerlen)) >= 0) {
+					if (n_conns == MAX_CLIENTS || (c = calloc(1, sizeof *c)) == NULL) {
+						close(fd);
+						continue;
+					}
+					fcntl(fd, F_SETFL, O_NONBLOCK);
+					c->fd = fd;
+					c->peer = peer;
+					hist_reset(&c->latency);
+					tcp_stats_reset(&c->info);
+					conns[n_conns++] = c;
+					n_open++;
+
+					ev.events = EPOLLIN;
+					ev.data.ptr = c;
+					epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+				}
+				continue;
+			}
+
+			ssize_t len = read(c->fd, c->buf + c->have, sizeof c->buf - c->have);
+			if (len > 0) {
+				if (c->first_tick == 0)
+					c->first_tick = now;
+				c->last_tick = now;
+				c->have += len;
+				tcp_conn_parse(c, now_ns, counters, recvdata);
+			} else if (len == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+				tcp_sample(c->fd, &c->info);
+				epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+				close(c->fd);
+				c->fd = -1;
+				n_open--;
+			}
+		}
+
+		if (now >= next_sample) {
+			for (uint32_t i = 0; i < n_conns; ++i)
+				if (conns[i]->fd >= 0)
+					tcp_sample(conns[i]->fd, &conns[i]->info);
+			tcp_publish(j, conns, n_conns);
+			next_sample = now + tick_from_ns(TCP_SAMPLE_NS);
+		}
+	}
+
+	tcp_publish(j, conns, n_conns);
+	close(epfd);
+	return n_conns;
+}
+
+/**
+ * per connection goodput, message latency and TCP_INFO; closes and
+ * frees the connections
+ */
+static void tcp_report(struct jana_config *cfg, struct tcp_conn **conns, uint32_t n_conns)
+{
+	FILE *out = cfg->out;
+	char ip[INET_ADDRSTRLEN];
+
+	for (uint32_t i = 0; i < n_conns; ++i) {
+		struct tcp_conn *c = conns[i];
+		double sec = tick_to_ns(c->last_tick - c->first_tick) / 1e9;
+
+		inet_ntop(AF_INET, &(c->peer.sin_addr), ip, INET_ADDRSTRLEN);
+		fprintf(cfg->out, "> tcp [%u/%u] %s:%u %" PRIu64 " msgs (%" PRIu64 " B), %.3f Mbit/s goodput%s\n",
+			i+1, n_conns, ip, ntohs(c->peer.sin_port), c->msgs, c->bytes,
+			sec > 0 ? c->bytes * 8 / sec / 1e6 : 0.0,
+			c->bad ? ", framing lost" : "");
+		hist_print(out, "latency", &c->latency);
+		tcp_stats_print(out, &c->info);
+
+		FILE *store;
+		if (cfg->store != NULL && (store = store_begin(cfg, "server")) != NULL) {
+			fprintf(store, " peer=%s:%u rx_pkts=%" PRIu64 " rx_bytes=%" PRIu64 " rx_mbps=%.3f retrans=%u",
+				ip, ntohs(c->peer.sin_port), c->msgs, c->bytes,
+				sec > 0 ? c->bytes * 8 / sec / 1e6 : 0.0, c->info.retrans);
+			store_hist(store, "latency_us", &c->latency, 1000.0);
+			store_end(store);
+		}
+
+		if (c->fd >= 0)
+			close(c->fd);
+		free(c);
+	}
+}
+
+static int run_server(struct jana *j)
+{
+	struct jana_config *cfg = &j->cfg;
+	FILE *out = cfg->out, *log = cfg->log;
+	uint8_t *zero_bytes = j->buf;
+	char ip[INET_ADDRSTRLEN];
+
+	int result = -1;
+	int sockfd = cfg->join ? init_mcast_socket(cfg) : init_socket(&cfg->addr, true, log);
+	int listenfd = cfg->tcp ? tcp_listen(&cfg->addr, log) : -1;
+
+	// receivers of one group can share a host and a port
+	uint32_t rx_id = (uint32_t)getpid() * 2654435761u ^ (uint32_t)(uintptr_t)j;
+	char hello[32], ready[32];
+	snprintf(hello, sizeof hello, cfg->join ? "HELLO %u" : "HELLO", rx_id);
+	snprintf(ready, sizeof ready, cfg->join ? "READY %u" : "READY", rx_id);
+	inet_ntop(AF_INET, &(cfg->addr.sin_addr), ip, INET_ADDRSTRLEN);
+	fprintf(out, "> using %s:%d\n", ip, ntohs(cfg->addr.sin_port));
+
+	uint32_t           registered;
+
+	struct sockaddr_in *clients;
+	uint32_t           *counters;
+	uint64_t           *recvdata;
+	struct arrival     *arrivals;
+	struct integrity   *integrity;
+	struct drain       *drains;
+
+	clients  = calloc(MAX_CLIENTS, sizeof(struct sockaddr_in));
+	counters = calloc(MAX_CLIENTS, sizeof(uint32_t));
+	recvdata = calloc(MAX_CLIENTS, sizeof(uint64_t));
+	arrivals = calloc(MAX_CLIENTS, sizeof(struct arrival));
+	integrity = calloc(MAX_CLIENTS, sizeof(struct integrity));
+	drains   = calloc(MAX_CLIENTS, sizeof(struct drain));
+
+	uint64_t bin_ns = (uint64_t)cfg->burst_bin_us * 1000;
+	uint64_t bin_ticks = tick_from_ns(bin_ns);
+
+	if (sockfd < 0 || (cfg->tcp && listenfd < 0))
+		goto cleanup;
+
+	if (clients == NULL || counters == NULL || recvdata == NULL || arrivals == NULL ||
+		integrity == NULL || drains == NULL) {
+		log_perror(log, "run_server: failed to allocate buffers");
+		goto cleanup;
+	}
+
+	if (cfg->rt) {
+		rt_enter(cfg);
+		rt_prefault(zero_bytes, MAX_PKT_SIZE);
+	}
+
+	result = 0;
+
+init_phase:
+	for (uint32_t i = 0; i < MAX_CLIENTS; ++i)
+		arrival_reset(arrivals + i);
+	memset(integrity, 0, MAX_CLIENTS * sizeof(struct integrity));
+
+	{
+		struct sockaddr_in client;
+		uint32_t i = 0;
+		struct timespec tp_now;
+		registered = 0;
+
+		clock_gettime(CLOCK_MONOTONIC, &tp_now);
+		while (registered < cfg->n_clients) {
+			if (stopping(j))
+				goto cleanup;
+
+			if (clock_elapsed_sec(&tp_now) >= 1) {
+				clock_gettime(CLOCK_MONOTONIC, &tp_now);
+				fprintf(log, "\r> registering ");
+				fprintf(log, "%s [%u/%u]", SPINNER[i++ % 4], registered, cfg->n_clients);
+			}
+
+			if (read_message(sockfd, "HELLO", &client)) {
+				inet_ntop(AF_INET, &(client.sin_addr), ip, INET_ADDRSTRLEN);
+
+				fprintf(log, "\r> HELLO from %s\n", ip);
+				sendto(sockfd, hello, strlen(hello)+1, 0, (struct sockaddr*)&client, sizeof(struct sockaddr_in));
+
+				uint32_t idx;
+				for (idx = 0; idx < registered &&
+					!cmpaddr(clients + idx, &client);
+					++idx);
+
+				if (idx == registered) {
+					counters[registered] = 0;
+					recvdata[registered] = 0;
+					clients[registered++] = client;
+				}
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < registered; ++i)
+		memset(drains + chash(clients + i), 0, sizeof(struct drain));
+
+	usleep(500*1000);
+
+	for (uint32_t i = 0; i < registered; ++i)
+		sendto(sockfd, ready, strlen(ready)+1, 0, (struct sockaddr*)(clients + i), sizeof(struct sockaddr_in));
+
+	{
+		struct sockaddr_in client;
+		struct timespec    tp_now;
+		uint32_t i = registered;
+
+		clock_gettime(CLOCK_MONOTONIC, &tp_now);
+
+		while (clock_elapsed_sec(&tp_now) < 5 && i > 0 && !stopping(j)) {
+			if (read_message(sockfd, "SETGO", &client)) {
+				i--;
+			}
+		}
+
+		if (i > 0) {
+			// system("./beep-error.exe");
+			if (!stopping(j))
+				result = -1;
+			goto cleanup;
+		}
+	}
+
+	{
+		for (int i = 0; i < registered; ++i) {
+			struct sockaddr_in *addr = clients + i;
+			uint32_t f = chash(addr);
+			inet_ntop(AF_INET, &(addr->sin_addr), ip, INET_ADDRSTRLEN);
+			fprintf(out, "> [%d/%u (%u)] %s:%u %u\n", i+1, registered, f,
+				ip, ntohs(addr->sin_port), counters[f]);
+		}
+	}
+
+	{
+		struct sockaddr addr;
+		socklen_t       fromlen = sizeof addr;
+		struct rt_window rtw;
+		struct perf_window pw;
+		struct tcp_conn *conns[MAX_CLIENTS];
+		uint32_t        n_conns = 0;
+		uint64_t        deadline;
+		uint32_t        n = 0;
+		uint64_t        n_empty = 0, n_error = 0, in_recv = 0;
+		struct jana_hist syscall, outside;
+		uint64_t        t0 = 0, t1 = 0, last = 0, next_publish = 0;
+		uint64_t        end_by, began, ran;
+		uint32_t        n_ended = 0;
+
+		hist_reset(&syscall);
+		hist_reset(&outside);
+
+		if (cfg->rt)
+			rt_window_begin(&rtw);
+		if (cfg->perf)
+			perf_window_begin(&pw, log);
+
+		tick_rebase(&j->base);
+		deadline = tick_now() + tick_from_ns((uint64_t)cfg->testtime * 1000000000);
+		end_by = deadline + tick_from_ns(DRAIN_MAX_NS);
+		began = tick_now();
+		atomic_store(&j->live.in_test, true);
+		fprintf(log, "> running network test");
+		if (listenfd >= 0)
+			n_conns = tcp_test(j, listenfd, deadline, conns, counters, recvdata);
+		else for (;;) {
+			if (n++ % TICK_CHECK_EVERY == 0) {
+				uint64_t now = tick_now();
+				if (now >= end_by || stopping(j))
+					break;
+
+				server_publish(j, registered, clients, counters, recvdata, arrivals, integrity,
+					now >= next_publish);
+				if (now >= next_publish)
+					next_publish = now + tick_from_ns(PUBLISH_NS);
+			}
+
+			if (cfg->overhead)
+				t0 = tick_now();
+
+			int len = recvfrom(sockfd, zero_bytes, MAX_PKT_SIZE, 0, &addr, &fromlen);
+
+			if (cfg->overhead) {
+				t1 = tick_now();
+				in_recv += t1 - t0;
+			}
+
+			// a client that finished early is already probing the clock
+			if (len > 0 && len < 100 && zero_bytes[0] == 'S') {
+				zero_bytes[len] = '\0';
+				if (answer_sync(sockfd, (char*)zero_bytes, clock_now_ns(CLOCK_REALTIME),
+						(struct sockaddr_in*)&addr))
+					continue;
+			}
+
+			// packet ids never start with 'E', it would take 1.1G packets
+			if (len > 0 && len < 100 && zero_bytes[0] == 'E') {
+				uint32_t f = chash((struct sockaddr_in *)&addr);
+				zero_bytes[len] = '\0';
+				if (strncmp((char*)zero_bytes, "END ", 4) == 0) {
+					if (drain_end(drains + f, arrivals + f, (char*)zero_bytes) &&
+						++n_ended == registered) {
+						uint64_t straggle = tick_now() + tick_from_ns(DRAIN_NS);
+						if (straggle < end_by)
+							end_by = straggle;
+					}
+					continue;
+				}
+			}
+
+			if (len > 0 && zero_bytes[0] == 'W')
+				continue;
+
+			if (len > 0) {
+				uint32_t f = chash((struct sockaddr_in *)&addr);
+				uint64_t at = cfg->overhead ? t1 : tick_now();
+				counters[f] = counters[f] + 1; //ntohl(packet);
+				recvdata[f] = recvdata[f] + len;
+				arrival_add(arrivals + f, at, len, bin_ticks, bin_ns);
+				if (len >= sizeof(uint32_t)) {
+					uint32_t id = ntohl(*(uint32_t*)zero_bytes);
+					arrival_seq(arrivals + f, id);
+					drain_add(drains + f, id, at, len);
+				}
+				if (cfg->join && len >= PAYLOAD_MIN_STAMP) {
+					int64_t delay = clock_now_ns(CLOCK_REALTIME) - payload_stamp_read(zero_bytes);
+					if (delay >= 0)
+						hist_add(&arrivals[f].delay, (uint64_t)delay);
+					else
+						arrivals[f].delay_negative++;
+				}
+
+				if (cfg->verify) {
+					switch (payload_check(zero_bytes, len, cfg->verify_seed)) {
+					case payload_ok:        integrity[f].ok++; break;
+					case payload_corrupt:   integrity[f].corrupt++; break;
+					case payload_truncated: integrity[f].truncated++; break;
+					}
+				}
+
+				if (cfg->overhead) {
+					hist_add(&syscall, tick_to_ns(t1 - t0));
+					if (last != 0)
+						hist_add(&outside, tick_to_ns(t0 - last));
+					last = t1;
+				}
+			} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				n_empty++;
+			} else {
+				n_error++;
+			}
+		}
+		// past the deadline while the clients drain
+		ran = tick_now() - began;
+		atomic_store(&j->live.in_test, false);
+		tick_rebase_end(&j->base);
+		fprintf(log, "\r> network test completed\n");
+
+		if (listenfd < 0) {
+			server_publish(j, registered, clients, counters, recvdata, arrivals, integrity, true);
+			server_results(sockfd, registered, clients, counters, recvdata, arrivals, drains);
+		}
+
+		if (cfg->perf)
+			perf_window_end(&pw, out);
+		if (cfg->rt)
+			rt_window_end(&rtw, out);
+
+		tcp_report(cfg, conns, n_conns);
+
+		if (cfg->overhead) {
+			fprintf(out, "> tool overhead: %.1f%% of the test spent in recvfrom\n",
+				ran ? 100.0 * in_recv / ran : 0.0);
+			hist_print(out, "recvfrom", &syscall);
+			hist_print(out, "between pkts", &outside);
+			fprintf(out, ">   errors         %" PRIu64 " empty polls (EAGAIN), %" PRIu64 " other\n",
+				n_empty, n_error);
+		}
+	}
+
+	usleep(500*1000);
+
+	{
+		for (int i = 0; i < registered; ++i) {
+			struct sockaddr_in *addr = clients + i;
+			uint32_t f = chash(addr);
+			inet_ntop(AF_INET, &(addr->sin_addr), ip, INET_ADDRSTRLEN);
+			fprintf(out, "> [%d/%u (%u)] %s:%u %u pkts (%" PRIu64 " B)\n", i+1, registered, f,
+				ip, ntohs(addr->sin_port), counters[f], recvdata[f]);
+			struct arrival *a = arrivals + f;
+			uint64_t span = a->last > a->first ? tick_to_ns(a->last - a->first) : 0;
+			struct drain_report dr;
+
+			drain_summary(drains + f, &dr);
+			if (listenfd < 0) {
+				arrival_print(out, a, bin_ticks, bin_ns);
+				drain_print(out, drains + f, &dr);
+			}
+			if (cfg->verify)
+				fprintf(out, ">   %-14s %" PRIu64 " ok, %" PRIu64 " corrupt, %" PRIu64 " truncated\n", "integrity",
+					integrity[f].ok, integrity[f].corrupt, integrity[f].truncated);
+
+			FILE *store;
+			if (listenfd < 0 && cfg->store != NULL && (store = store_begin(cfg, "server")) != NULL) {
+				fprintf(store, " peer=%s:%u rx_pkts=%u rx_bytes=%" PRIu64 " rx_mbps=%.3f", ip,
+					ntohs(addr->sin_port), counters[f], recvdata[f],
+					span ? recvdata[f] * 8e3 / span : 0.0);
+				fprintf(store, " lost=%" PRIu64 " loss_pct=%.4f reordered=%" PRIu64,
+					arrival_lost(a), a->next_id ? 100.0 * arrival_lost(a) / a->next_id : 0.0, a->reordered);
+				if (cfg->verify)
+					fprintf(store, " corrupt=%" PRIu64 " truncated=%" PRIu64,
+						integrity[f].corrupt, integrity[f].truncated);
+				store_hist(store, "gap_us", &a->gap, 1000.0);
+				store_hist(store, "burst_us", &a->burst, 1000.0);
+				if (a->delay.count > 0)
+					store_hist(store, "delay_us", &a->delay, 1000.0);
+				if (a->delay_negative > 0)
+					fprintf(store, " delay_negative=%" PRIu64, a->delay_negative);
+				fprintf(store, " peak_burst_pkts=%u", a->peak_burst_pkts);
+				if (drains[f].ended && drains[f].synced)
+					fprintf(store, " drain_ms=%.3f inflight_pkts=%u queue_bytes=%" PRIu64 " queue_ms=%.3f",
+						dr.drain_ns / 1e6, dr.inflight, dr.bytes, dr.queue_ns / 1e6);
+				store_end(store);
+			}
+		}
+		fflush(out);
+	}
+
+	{
+		char           *data = (char*)zero_bytes;
+		struct sockaddr addr;
+		int             len;
+		socklen_t       fromlen = sizeof addr;
+		uint32_t        consumed = 0;
+		do {
+			len = recvfrom(sockfd, data, MAX_PKT_SIZE - 1, 0, &addr, &fromlen);
+			if (len > 0) {
+				data[len] = '\0';
+				if (!answer_sync(sockfd, data, clock_now_ns(CLOCK_REALTIME), (struct sockaddr_in*)&addr))
+					consumed++;
+			}
+		} while (len > 0);
+		fprintf(out, "> consumed %u late packets\n", consumed);
+		fflush(out);
+	}
+
+	live_set(&j->live.tests, atomic_load(&j->live.tests) + 1);
+
+	if (cfg->keepalive && !stopping(j)) {
+		memset(clients, 0, MAX_CLIENTS * sizeof(struct sockaddr_in));
+		memset(counters, 0, MAX_CLIENTS * sizeof(uint32_t));
+		memset(recvdata, 0, MAX_CLIENTS * sizeof(uint64_t));
+		goto init_phase;
+	}
+
+cleanup:
+	free(drains);
+	free(integrity);
+	free(arrivals);
+	free(recvdata);
+	free(counters);
+	free(clients);
+	if (listenfd >= 0)
+		close(listenfd);
+	if (sockfd >= 0)
+		close(sockfd);
+	return result;
+}
+
+
+//
+// PUBLIC API
+//
+
+static pthread_once_t jana_once = PTHREAD_ONCE_INIT;
+
+static void jana_init_once(void)
+{
+	tick_calibrate();
+	crc32c_init();
+}
+
+static void jana_init(void)
+{
+	pthread_once(&jana_once, jana_init_once);
+}
+
+void jana_config_init(struct jana_config *cfg)
+{
+	memset(cfg, 0, sizeof *cfg);
+
+	cfg->testtime = 10;
+	cfg->sync_probes = 16;
+	cfg->rt_cpu = -1;
+	cfg->rt_prio = 50;
+	cfg->n_sockets = 8;
+	cfg->replay_speed = 1.0;
+	cfg->raw_batch = 64;
+	cfg->burst_bin_us = 10;
+	cfg->sweep_warmup_ms = 200;
+	cfg->receivers = 1;
+	cfg->mcast_ttl = 1;
+	cfg->label = "default";
+	cfg->addr.sin_family = AF_INET;
+	cfg->addr.sin_port = htons(3000);
+}
+
+struct jana *jana_create(const struct jana_config *cfg)
+{
+	bool valid = cfg->mode == jana_client || cfg->mode == jana_server || cfg->mode == jana_dummy;
+
+	if (cfg->tcp && cfg->scenario != NULL)
+		valid = false;
+	if (cfg->raw_if != NULL && (cfg->tcp || cfg->scenario != NULL))
+		valid = false;
+	if (cfg->verify && (cfg->tcp || cfg->raw_if != NULL || cfg->scenario != NULL))
+		valid = false;
+	if (cfg->n_sweep_sizes > 0 && (cfg->n_sweep_rates == 0 || cfg->tcp || cfg->raw_if != NULL ||
+		cfg->scenario != NULL || cfg->replay != NULL))
+		valid = false;
+	if (IN_MULTICAST(ntohl(cfg->addr.sin_addr.s_addr)) && cfg->mode != jana_server &&
+		(cfg->receivers == 0 || cfg->tcp || cfg->raw_if != NULL || cfg->scenario != NULL ||
+		cfg->verify || cfg->n_sweep_sizes > 0))
+		valid = false;
+	if (cfg->join && (cfg->mode != jana_server || cfg->tcp ||
+		!IN_MULTICAST(ntohl(cfg->join_group.s_addr))))
+		valid = false;
+	if (cfg->rt && (cfg->rt_cpu < -1 || cfg->rt_cpu >= CPU_SETSIZE))
+		valid = false;
+#ifndef JANA_XDP
+	if (cfg->raw_xdp)
+		valid = false;
+#endif
+
+	if (!valid) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	struct jana *j = calloc(1, sizeof *j);
+	if (j == NULL)
+		return NULL;
+
+	jana_init();
+
+	j->cfg = *cfg;
+	if (cfg->out == NULL || cfg->log == NULL) {
+		j->devnull = fopen("/dev/null", "w");
+		if (j->devnull == NULL) {
+			free(j);
+			return NULL;
+		}
+		if (cfg->out == NULL)
+			j->cfg.out = j->devnull;
+		if (cfg->log == NULL)
+			j->cfg.log = j->devnull;
+	}
+
+	j->seed = cfg->seed ? cfg->seed : (unsigned int)time(NULL) ^ (unsigned int)getpid();
+	tick_rebase(&j->base);
+	pthread_mutex_init(&j->lock, NULL);
+
+	if (cfg->verify && !crc32c_ok) {
+		fprintf(j->cfg.log, "> verify: crc32c via %s failed its self-check\n", crc32c_name);
+		jana_destroy(j);
+		errno = EIO;
+		return NULL;
+	}
+	if (cfg->verify)
+		fprintf(j->cfg.log, "> verify: crc32c via %s, seed %u\n", crc32c_name, cfg->verify_seed);
+
+	return j;
+}
+
+int jana_run(struct jana *j)
+{
+	atomic_store(&j->stop, false);
+
+	if (j->cfg.mode == jana_server)
+		return run_server(j);
+
+	return run_client(j);
+}
+
+static void *jana_thread(void *arg)
+{
+	struct jana *j = arg;
+	j->result = jana_run(j);
+	return NULL;
+}
+
+int jana_start(struct jana *j)
+{
+	if (j->started) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	int err = pthread_create(&j->thread, NULL, jana_thread, j);
+	if (err != 0) {
+		errno = err;
+		return -1;
+	}
+
+	j->started = true;
+	return 0;
+}
+
+void jana_stop(struct jana *j)
+{
+	atomic_store(&j->stop, true);
+}
+
+int jana_wait(struct jana *j)
+{
+	if (!j->started)
+		return j->result;
+
+	pthread_join(j->thread, NULL);
+	j->started = false;
+	return j->result;
+}
+
+void jana_destroy(struct jana *j)
+{
+	if (j == NULL)
+		return;
+
+	if (j->started) {
+		jana_stop(j);
+		jana_wait(j);
+	}
+
+	pthread_mutex_destroy(&j->lock);
+	if (j->devnull != NULL)
+		fclose(j->devnull);
+	free(j);
+}
+
+void jana_stats(struct jana *j, struct jana_stats *out)
+{
+	struct live *l = &j->live;
+
+	out->tests        = atomic_load_explicit(&l->tests, memory_order_relaxed);
+	out->in_test      = atomic_load_explicit(&l->in_test, memory_order_relaxed);
+	out->tx_pkts      = atomic_load_explicit(&l->tx_pkts, memory_order_relaxed);
+	out->tx_bytes     = atomic_load_explicit(&l->tx_bytes, memory_order_relaxed);
+	out->tx_errors    = atomic_load_explicit(&l->tx_errors, memory_order_relaxed);
+	out->rx_pkts      = atomic_load_explicit(&l->rx_pkts, memory_order_relaxed);
+	out->rx_bytes     = atomic_load_explicit(&l->rx_bytes, memory_order_relaxed);
+	out->rx_lost      = atomic_load_explicit(&l->rx_lost, memory_order_relaxed);
+	out->rx_reordered = atomic_load_explicit(&l->rx_reordered, memory_order_relaxed);
+	out->rx_corrupt   = atomic_load_explicit(&l->rx_corrupt, memory_order_relaxed);
+}
+
+bool jana_hist(struct jana *j, enum jana_hist_id id, struct jana_hist *out)
+{
+	bool has;
+
+	if ((unsigned)id >= JANA_HIST_COUNT)
+		return false;
+
+	pthread_mutex_lock(&j->lock);
+	has = j->has_hist[id];
+	if (has)
+		*out = j->hist[id];
+	pthread_mutex_unlock(&j->lock);
+
+	return has;
+}
@@ -23,6 +23,8 @@
 #define u64f PRIu64
 #endif
 
+#include "schedule.h"
+
 #define MAGIC_NUMBER      (0xa1b2c3d4)
 #define MAGIC_NUMBER_SWAP (0xd4c3b2a1)
 
@@ -107,9 +109,12 @@ void usage() {
     fprintf(stderr, "  -c, --client   ipv4 address of client\n");
     fprintf(stderr, "  -s, --server   ipv4 address of server\n");
     fprintf(stderr, "  -d, --dump     dump pcap global header\n");
+    fprintf(stderr, "  -P, --port     only packets to this udp port\n");
+    fprintf(stderr, "  -w, --write    write a replay schedule for jana --replay instead of csv\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "Examples:\n");
-    fprintf(stderr, "  pcap2csv capture.pcap 192.168.1.24 192.168.1.25\n");
+    fprintf(stderr, "  pcap2csv capture.pcap -c 192.168.1.24 -s 192.168.1.25\n");
+    fprintf(stderr, "  pcap2csv prod.pcap -c 10.0.0.3 -s 10.0.0.9 -P 5004 -w prod.sched\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "Built " __DATE__ " " __TIME__ "\n");
     exit(1);
@@ -121,6 +126,8 @@ int main(int argc, char *argv[])
 	bool     dump_pcap_header = false;
 	uint32_t self_addr = 0;
 	uint32_t server_addr = 0;
+	uint16_t server_port = 0;
+	char     *sched_file = NULL;
 
 	if (argc == 1 ||
 		strcmp("-h", argv[1]) == 0 ||
@@ -149,6 +156,17 @@ int main(int argc, char *argv[])
 			} else if (strcmp("-d", argv[j]) == 0 ||
 				strcmp("--dump", argv[j]) == 0) {
 				dump_pcap_header = true;
+			} else if ((strcmp("-P", argv[j]) == 0 ||
+				strcmp("--port", argv[j]) == 0) && j + 1 < argc) {
+				j++;
+				if (!sscanf(argv[j], "%hu", &server_port)) {
+					fprintf(stderr, "invalid port: %s\n", argv[j]);
+					exit(1);
+				}
+			} else if ((strcmp("-w", argv[j]) == 0 ||
+				strcmp("--write", argv[j]) == 0) && j + 1 < argc) {
+				j++;
+				sched_file = argv[j];
 			} else {
 				fprintf(stderr, "unknown option %s\n", argv[j]);
 				exit(1);
@@ -200,74 +218,96 @@ int main(int argc, char *argv[])
 
 	fseek(pcap, 4, SEEK_CUR);
 
-	{
-		uint8_t  *memory;
-		size_t   begin, mem_len;
-
-		begin = ftell(pcap);
-		fseek(pcap, 0, SEEK_END);
-		mem_len = ftell(pcap) - begin;
-		fseek(pcap, begin, SEEK_SET);
+	FILE *sched = NULL;
+	sched_hdr_t sched_hdr = { SCHED_MAGIC, SCHED_VERSION, 0, 0, 0 };
 
-		memory = calloc(mem_len, sizeof(uint8_t));
-		if (memory == NULL) {
-			perror("could not get memory for pcap file");
+	if (sched_file != NULL) {
+		sched = fopen(sched_file, "wb");
+		if (sched == NULL) {
+			perror("error writing schedule");
 			exit(1);
 		}
+		// header is rewritten with the totals at the end
+		fwrite(&sched_hdr, sizeof sched_hdr, 1, sched);
+	} else {
+		printf("packet,time,bytes\n");
+	}
 
-		fread((void*)memory, sizeof(uint8_t), mem_len, pcap);
+	{
+		// one record at a time, so captures larger than memory work
+		static uint8_t memory[65536 + 64];
+		pcaprec_hdr_t  rec_hdr;
+		bool           seen_go = false;
+		uint64_t       last_usec = 0;
 
-		printf("packet,time,bytes\n");
+		while (fread(&rec_hdr, sizeof rec_hdr, 1, pcap) == 1) {
+			uint32_t keep = rec_hdr.incl_len < sizeof memory ? rec_hdr.incl_len : sizeof memory;
 
-		bool seen_go = false;
+			if (fread(memory, 1, keep, pcap) != keep)
+				break;
+			if (keep < rec_hdr.incl_len)
+				fseek(pcap, rec_hdr.incl_len - keep, SEEK_CUR);
 
-		while (mem_len > 0) {
-			pcaprec_hdr_t *rec_hdr = (pcaprec_hdr_t*)memory;
-			memory += sizeof(pcaprec_hdr_t);
+			// ethernet header, ip header without options, udp header
+			if (keep < 14 + sizeof(ip_hdr_t) + sizeof(udp_hdr_t) + sizeof(uint32_t))
+				continue;
 
-			memory += 14; // ethernet header
-			ip_hdr_t *ip_hdr = (ip_hdr_t*)(memory);
-			memory += sizeof(ip_hdr_t);
+			ip_hdr_t *ip_hdr = (ip_hdr_t*)(memory + 14);
 
 			// version is encoded in leftmost four bits
 			uint8_t version = (ip_hdr->ver_len >> 4);
+			uint32_t ip_len = (ip_hdr->ver_len & 0xf) * 4;
 
 			// version must be ip v4
-			if (version != 4) goto skip;
+			if (version != 4) continue;
 
 			// protocol must be udp
-
-			if (ip_hdr->protocol != 17) goto skip;
+			if (ip_hdr->protocol != 17) continue;
 
 			// packets from myself to server
-			if (ip_hdr->src_addr != self_addr) goto skip;
-			if (ip_hdr->dst_addr != server_addr) goto skip;
+			if (ip_hdr->src_addr != self_addr) continue;
+			if (ip_hdr->dst_addr != server_addr) continue;
+
+			// later fragments carry no udp header
+			if ((ntohs(ip_hdr->flags) & 0x1fff) != 0) continue;
+
+			if (14 + ip_len + sizeof(udp_hdr_t) + sizeof(uint32_t) > keep) continue;
+
+			udp_hdr_t *udp_hdr = (udp_hdr_t*)(memory + 14 + ip_len);
+			uint8_t *pktdata = (uint8_t*)udp_hdr + sizeof(udp_hdr_t);
+			uint16_t datalen = ntohs(udp_hdr->pkt_size) - sizeof(udp_hdr_t);
 
-			udp_hdr_t *udp_hdr = (udp_hdr_t*)memory;
-			memory += sizeof(udp_hdr_t);
+			if (server_port != 0 && ntohs(udp_hdr->dst_port) != server_port) continue;
 
-			uint8_t *pktdata = memory;
-			uint16_t datalen = ntohs(udp_hdr->pkt_size) - sizeof(udp_hdr);
+			uint64_t usec = ((uint64_t)rec_hdr.ts_sec) * 1000 * 1000 + rec_hdr.ts_usec;
 
-			uint64_t usec = ((uint64_t)rec_hdr->ts_sec) * 1000 * 1000 + rec_hdr->ts_usec;
+			if (sched != NULL) {
+				sched_rec_t rec;
+				rec.gap_us = sched_hdr.count == 0 || usec < last_usec ? 0 : (uint32_t)(usec - last_usec);
+				rec.size   = datalen;
+				fwrite(&rec, sizeof rec, 1, sched);
 
-			if (seen_go) {
+				sched_hdr.count++;
+				sched_hdr.duration_us += rec.gap_us;
+				sched_hdr.bytes += rec.size;
+				last_usec = usec;
+			} else if (seen_go) {
 				uint32_t data = ntohl(*((uint32_t*)pktdata));
 				printf("%u,%" u64f ",%u\n", data, usec, datalen);
-			} else if (strncmp("SETGO", pktdata, 5) == 0) {
+			} else if (strncmp("SETGO", (char*)pktdata, 5) == 0) {
 				seen_go = true;
 			}
-
-skip:
-			memory = ((uint8_t*)rec_hdr);
-			memory += sizeof(pcaprec_hdr_t);
-			memory += rec_hdr->incl_len;
-
-			mem_len -= sizeof(pcaprec_hdr_t);
-			mem_len -= rec_hdr->incl_len;
 		}
 	}
 
+	if (sched != NULL) {
+		fseek(sched, 0, SEEK_SET);
+		fwrite(&sched_hdr, sizeof sched_hdr, 1, sched);
+		fclose(sched);
+		fprintf(stderr, "%s: %" u64f " packets, %" u64f " B over %.3f s\n", sched_file,
+			sched_hdr.count, sched_hdr.bytes, sched_hdr.duration_us / 1e6);
+	}
+
 	fclose(pcap);
 	return(0);
 }
\ No newline at end of file
@@ -0,0 +1,34 @@
+#ifndef JANA_SCHEDULE_H
+#define JANA_SCHEDULE_H
+
+#include <stdint.h>
+
+//
+// REPLAY SCHEDULE FILE FORMAT
+//
+// written by `pcap2csv -w`, memory-mapped by `jana --replay`. all fields
+// are in host byte order; the magic number tells a foreign file apart.
+//
+// HEADER   (sched_hdr_t)
+// RECORD   (sched_rec_t)
+// RECORD   (sched_rec_t)
+// ...
+//
+
+#define SCHED_MAGIC   (0x4843534a) /* "JSCH" */
+#define SCHED_VERSION (1)
+
+typedef struct sched_hdr_s {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t count;              /* number of records */
+	uint64_t duration_us;        /* sum of all gaps */
+	uint64_t bytes;              /* sum of all payload sizes */
+} sched_hdr_t;
+
+typedef struct sched_rec_s {
+	uint32_t gap_us;             /* since the previous packet, 0 for the first */
+	uint32_t size;               /* udp payload bytes */
+} sched_rec_t;
+
+#endif